@@ -0,0 +1,72 @@
+#ifndef EXPERIMENT_ACCUMULATOR_H
+#define EXPERIMENT_ACCUMULATOR_H
+
+#include <omp.h>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cassert>
+
+constexpr int64_t accumulator_bin_bytes = 256 << 10;          // widest target range of one bin, about an L2
+constexpr int64_t accumulator_min_bin_bytes = 4 << 10;        // bins are not narrowed below this range
+constexpr size_t accumulator_round_updates = size_t{1} << 24; // suggested updates between two applies
+
+/**
+ * Propagation blocking (Beamer et al., IPDPS'17) for scatter updates target[index] += value.
+ * Binning: every thread appends its updates to its own buffer of the bin covering index, each bin
+ * a contiguous, cache-sized range of target. Accumulation: apply() hands every bin to one thread,
+ * which adds the buffers of all threads for that bin with plain stores, so the random writes stay
+ * inside the bin's range and need no atomics.
+ * Buffered memory grows with the number of updates; callers with many updates apply in rounds.
+ */
+template<typename IndexT, typename ValueT>
+class ScatterAccumulator {
+private:
+    ValueT *target;
+    int bin_shift;
+    size_t bin_number;
+    std::vector<std::vector<std::vector<std::pair<IndexT, ValueT>>>> buffers;   // [thread][bin]
+public:
+    ScatterAccumulator(ValueT *target, int64_t size, int threads = omp_get_max_threads())
+            : target{target}, bin_shift{0}, buffers(threads) {
+        while ((int64_t{1} << bin_shift) * static_cast<int64_t>(sizeof(ValueT)) < accumulator_bin_bytes) {
+            bin_shift++;
+        }
+        // narrower bins until every thread has a few of them to accumulate
+        while ((size >> bin_shift) < 4 * threads &&
+               (int64_t{1} << (bin_shift - 1)) * static_cast<int64_t>(sizeof(ValueT)) >= accumulator_min_bin_bytes) {
+            bin_shift--;
+        }
+        bin_number = (size + (int64_t{1} << bin_shift) - 1) >> bin_shift;
+        for (auto &bins: buffers) {
+            bins.resize(bin_number);
+        }
+    }
+
+    /**
+     * Binning phase, called by any thread of the region the accumulator was sized for.
+     */
+    void add(IndexT index, ValueT value) {
+        assert(omp_get_thread_num() < static_cast<int>(buffers.size()));
+        buffers[omp_get_thread_num()][static_cast<size_t>(index) >> bin_shift].emplace_back(index, value);
+    }
+
+    /**
+     * Accumulation phase. Call from every thread of the parallel region once all adds are issued,
+     * or from outside a region. Empties the buffers, so binning can start over for the next round.
+     */
+    void apply() {
+#pragma omp barrier
+#pragma omp for schedule(dynamic, 1)
+        for (size_t bin = 0; bin < bin_number; ++bin) {
+            for (auto &bins: buffers) {
+                for (auto const &[index, value]: bins[bin]) {
+                    target[index] += value;
+                }
+                bins[bin].clear();
+            }
+        }
+    }
+};
+
+#endif //EXPERIMENT_ACCUMULATOR_H
@@ -0,0 +1,149 @@
+#ifndef EXPERIMENT_BETWEENNESS_H
+#define EXPERIMENT_BETWEENNESS_H
+
+#include "graph.h"
+#include "atomics.h"
+#include "bfs.h"
+#include <vector>
+#include <iterator>
+#include <omp.h>
+
+/**
+ * Brandes betweenness centrality. Each source is processed level-synchronously: the forward
+ * pass discovers a level in parallel and then pulls sigma (number of shortest paths) for every
+ * vertex of the new level from its in-neighbors one level up; the backward pass walks the
+ * levels in reverse and pulls dependencies from the DAG children, so no floating point
+ * atomics are needed. All per-source buffers are kept between sources and only the visited
+ * part of them is reset.
+ */
+template<typename T, typename DstT = T, typename PropT = int>
+class Betweenness {
+private:
+    Graph<T, DstT> const &graph;
+    std::vector<PropT> depth;
+    std::vector<double> sigma;
+    std::vector<double> delta;
+    std::vector<T> order;               // visited vertices, level by level
+    std::vector<size_t> level_start;    // level l is order[level_start[l], level_start[l+1])
+    std::vector<double> centrality;
+
+    void forward(T source);
+    void backward(T source);
+public:
+    explicit Betweenness(Graph<T, DstT> const &graph)
+        : graph{graph}, depth(graph.get_vertex_number(), get_max_prop<PropT>()),
+        sigma(graph.get_vertex_number(), 0), delta(graph.get_vertex_number(), 0),
+        centrality(graph.get_vertex_number(), 0) {
+        order.reserve(graph.get_vertex_number());
+        graph.build_transpose();    // sigma is pulled from in_neighbors in parallel
+    }
+    void accumulate(T source);
+    void accumulate(std::vector<T> const &sources) {
+        for (T const &s : sources) {
+            accumulate(s);
+        }
+    }
+    void accumulate_all() {
+        for (T s = 0; s < graph.get_vertex_number(); ++s) {
+            accumulate(s);
+        }
+    }
+    /**
+     * Dependencies summed over the processed sources. In undirected graphs every
+     * shortest path is seen from both ends, so the sum is halved there.
+     */
+    [[nodiscard]] std::vector<double> scores() const {
+        std::vector<double> result(centrality);
+        if (!graph.is_directed()) {
+            for (auto &c : result) {
+                c /= 2;
+            }
+        }
+        return result;
+    }
+};
+
+template<typename T, typename DstT, typename PropT>
+void Betweenness<T, DstT, PropT>::forward(T source) {
+    order.clear();
+    level_start.clear();
+    depth[source] = 0;
+    sigma[source] = 1;
+    order.emplace_back(source);
+    level_start.emplace_back(0);
+    level_start.emplace_back(1);
+    for (PropT level = 0; level_start[level] < level_start[level + 1]; ++level) {
+        size_t const begin = level_start[level];
+        size_t const end = level_start[level + 1];
+#pragma omp parallel default(shared)
+        {
+            std::vector<T> local_next;
+#pragma omp for nowait schedule(dynamic, 64)
+            for (size_t i = begin; i < end; ++i) {
+                for (auto const &w : graph.out_neighbors(order[i])) {
+                    T x = get_dst_id(w);
+                    if (is_max_prop(depth[x])
+                        && compare_and_swap(depth[x], get_max_prop<PropT>(), static_cast<PropT>(level + 1))) {
+                        local_next.emplace_back(x);
+                    }
+                }
+            }
+#pragma omp critical
+            {
+                order.insert(order.end(), local_next.begin(), local_next.end());
+            }
+        }
+        level_start.emplace_back(order.size());
+        size_t const next_end = order.size();
+#pragma omp parallel for default(shared) schedule(dynamic, 64)
+        for (size_t i = end; i < next_end; ++i) {
+            T w = order[i];
+            double paths{};
+            for (auto const &u : graph.in_neighbors(w)) {
+                if (depth[get_dst_id(u)] == level) {
+                    paths += sigma[get_dst_id(u)];
+                }
+            }
+            sigma[w] = paths;
+        }
+    }
+}
+
+template<typename T, typename DstT, typename PropT>
+void Betweenness<T, DstT, PropT>::backward(T source) {
+    // the last entry of level_start closes an empty level
+    for (auto level = static_cast<PropT>(level_start.size() - 2); level-- > 0;) {
+        size_t const begin = level_start[level];
+        size_t const end = level_start[level + 1];
+#pragma omp parallel for default(shared) schedule(dynamic, 64)
+        for (size_t i = begin; i < end; ++i) {
+            T v = order[i];
+            double dependency{};
+            for (auto const &w : graph.out_neighbors(v)) {
+                T x = get_dst_id(w);
+                if (depth[x] == level + 1) {
+                    dependency += sigma[v] / sigma[x] * (1 + delta[x]);
+                }
+            }
+            delta[v] = dependency;
+            if (v != source) {
+                centrality[v] += dependency;
+            }
+        }
+    }
+}
+
+template<typename T, typename DstT, typename PropT>
+void Betweenness<T, DstT, PropT>::accumulate(T source) {
+    forward(source);
+    backward(source);
+#pragma omp parallel for default(shared)
+    for (size_t i = 0; i < order.size(); ++i) {
+        T v = order[i];
+        depth[v] = get_max_prop<PropT>();
+        sigma[v] = 0;
+        delta[v] = 0;
+    }
+}
+
+#endif //EXPERIMENT_BETWEENNESS_H
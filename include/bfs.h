@@ -3,14 +3,21 @@
 
 #include "graph.h"
 #include "memory.h"
+#include "bitmap.h"
+#include "atomics.h"
 #include <vector>
 #include <random>
 #include <type_traits>
+#include <optional>
+#include <limits>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
 template<typename T>
 inline
 constexpr T get_max_prop() {
-    return T{-1};
+    return static_cast<T>(-1);
 }
 
 template<typename T>
@@ -19,6 +26,31 @@ constexpr bool is_max_prop(T const &prop) {
     return prop == get_max_prop<T>();
 }
 
+enum class Direction : int {
+    push,
+    pull
+};
+
+/**
+ * Per-iteration statistics handed to the observer of a traversal kernel. The frontier is the
+ * one the iteration starts from; active vertices are the ones its loop examines (the frontier
+ * when pushing, the unvisited vertices when pulling).
+ */
+struct IterStats {
+    int iter{};
+    Direction direction{Direction::push};
+    long long frontier_vertices{};
+    long long frontier_edges{};
+    long long active_vertices{};
+    long long edges_scanned{};
+    long long discovered{};
+    long long cachelines{};
+};
+
+struct NullIterObserver {
+    void operator()(IterStats const &) const {}
+};
+
 template<typename T, typename DstT>
 std::vector<T> pick_sources(Graph<T, DstT> const &graph, int n) {
     std::random_device rd;
@@ -36,37 +68,101 @@ std::vector<T> pick_sources(Graph<T, DstT> const &graph, int n) {
     return sources;
 }
 
-template<typename T, typename DstT, typename PropT = int>
-std::vector<PropT> do_bfs(Graph<T, DstT> const &graph, T root) {
+template<typename T, typename DstT, typename PropT = int, typename Observer = NullIterObserver>
+std::vector<PropT> do_bfs(Graph<T, DstT> const &graph, T root, Observer &&observer = {}) {
+    require_full_storage(graph, "do_bfs");
     std::vector<PropT> depth(graph.get_vertex_number(), get_max_prop<PropT>());
     std::queue<T> frontier;
     depth[root] = 0;
     frontier.emplace(root);
+    IterStats stats{0, Direction::push};
     while (!frontier.empty()) {
         T u = frontier.front(); frontier.pop();
+        if (depth[u] != stats.iter) {
+            observer(stats);
+            stats = IterStats{stats.iter + 1, Direction::push};
+        }
+        stats.frontier_vertices++;
+        stats.frontier_edges += graph.out_degree(u);
+        stats.active_vertices++;
         for (auto const &v : graph.out_neighbors(u)) {
+            stats.edges_scanned++;
             if (is_max_prop(depth[v])) {
                 depth[get_dst_id(v)] = depth[u] + 1;
                 frontier.emplace(get_dst_id(v));
+                stats.discovered++;
+            }
+        }
+    }
+    observer(stats);
+    return depth;
+}
+
+/**
+ * Level-synchronous top-down BFS for narrow depth types (e.g. uint8_t). The visited test goes
+ * to a Bitmap instead of depth, so the randomly accessed state is V/8 bytes, and depth is
+ * only written once per vertex. Returns std::nullopt if a depth does not fit into PropT
+ * (the largest value is reserved as the unvisited sentinel); callers fall back to do_bfs.
+ */
+template<typename PropT = uint8_t, typename T, typename DstT, typename Observer = NullIterObserver>
+std::optional<std::vector<PropT>> do_bitmap_bfs(Graph<T, DstT> const &graph, T root, Observer &&observer = {}) {
+    require_full_storage(graph, "do_bitmap_bfs");
+    // the largest value of an unsigned PropT is taken by the sentinel
+    constexpr long long max_depth = std::numeric_limits<PropT>::max() - (std::is_unsigned_v<PropT> ? 1 : 0);
+    std::vector<PropT> depth(graph.get_vertex_number(), get_max_prop<PropT>());
+    Bitmap visited(graph.get_vertex_number());
+    visited.reset();
+    std::vector<T> frontier{root};
+    std::vector<T> next;
+    visited.set_bit(root);
+    depth[root] = 0;
+    for (int iter = 0; !frontier.empty(); ++iter) {
+        IterStats stats{iter, Direction::push, static_cast<long long>(frontier.size())};
+        for (T u : frontier) {
+            stats.frontier_edges += graph.out_degree(u);
+            for (auto const &v : graph.out_neighbors(u)) {
+                T x = get_dst_id(v);
+                if (!visited.get_bit(x)) {
+                    if (iter + 1 > max_depth) {
+                        return std::nullopt;
+                    }
+                    visited.set_bit(x);
+                    depth[x] = static_cast<PropT>(iter + 1);
+                    next.emplace_back(x);
+                }
             }
         }
+        stats.active_vertices = stats.frontier_vertices;
+        stats.edges_scanned = stats.frontier_edges;
+        stats.discovered = static_cast<long long>(next.size());
+        observer(stats);
+        frontier.swap(next);
+        next.clear();
     }
     return depth;
 }
 
-template<typename T, typename DstT, typename AddrT, typename PropT = int>
-std::tuple<long long, long long> do_cacheline_bfs(Graph<T, DstT> const &graph, T root, Memory<AddrT> &memory) {
+template<typename T, typename DstT, typename AddrT, typename PropT = int, typename Observer = NullIterObserver>
+std::tuple<long long, long long> do_cacheline_bfs(Graph<T, DstT> const &graph, T root, Memory<AddrT> &memory,
+                                                  Observer &&observer = {}) {
+    require_full_storage(graph, "do_cacheline_bfs");
     std::vector<PropT> depth(graph.get_vertex_number(), get_max_prop<PropT>());
     depth[root] = 0;
     long long edge_visit{};
     long long edge_visit_cacheline{};
     int sum = 1;
     int iter{};
+    long long frontier_edges = graph.out_degree(root);
     while (sum > 0) {
+        IterStats stats{iter, Direction::pull, sum, frontier_edges};
         sum = 0;
+        frontier_edges = 0;
+        long long prev_edge_visit = edge_visit;
+        long long prev_edge_visit_cacheline = edge_visit_cacheline;
         memory.reset(); // cache expire
         for (T v = 0; v < graph.get_vertex_number(); ++v) {
             if (is_max_prop(depth[v])) {
+                stats.active_vertices++;
                 bool flag = false;
                 for (auto const &u : graph.in_neighbors(v)) {
                     if (!is_max_prop(depth[u]) && depth[u] == iter) {
@@ -76,6 +172,7 @@ std::tuple<long long, long long> do_cacheline_bfs(Graph<T, DstT> const &graph, T
                 }
                 if (flag) {
                     sum++;
+                    frontier_edges += graph.out_degree(v);
                     int now_edge_offset{};
                     for (auto const &u : graph.in_neighbors(v)) {
                         edge_visit += 1;
@@ -89,9 +186,245 @@ std::tuple<long long, long long> do_cacheline_bfs(Graph<T, DstT> const &graph, T
                 }
             }
         }
+        stats.edges_scanned = edge_visit - prev_edge_visit;
+        stats.discovered = sum;
+        stats.cachelines = edge_visit_cacheline - prev_edge_visit_cacheline;
+        observer(stats);
         iter++;
     }
     return {edge_visit, edge_visit_cacheline};
 }
 
+/**
+ * Bottom-up (pull) BFS with early break. The frontier test of an in-neighbor is a random
+ * access, either into a frontier Bitmap or, with UseBitmap = false, into depth. With
+ * prefetch_distance > 0 the kernel prefetches that test for the neighbor prefetch_distance
+ * positions ahead, and the neighbor list of the vertex prefetch_distance positions ahead.
+ */
+template<bool UseBitmap = true, typename T, typename DstT, typename PropT = int, typename Observer = NullIterObserver>
+std::vector<PropT> do_pull_bfs(Graph<T, DstT> const &graph, T root, int prefetch_distance = 0,
+                               Observer &&observer = {}) {
+    require_full_storage(graph, "do_pull_bfs");
+    graph.build_transpose();    // here rather than lazily by the first thread of the parallel loop
+    int64_t const vertex_number = graph.get_vertex_number();
+    std::vector<PropT> depth(vertex_number, get_max_prop<PropT>());
+    Bitmap front(UseBitmap ? vertex_number : 0);
+    Bitmap next(UseBitmap ? vertex_number : 0);
+    front.reset();
+    next.reset();
+    if constexpr (UseBitmap) {
+        front.set_bit(root);
+    }
+    depth[root] = 0;
+    long long sum = 1;
+    long long frontier_edges = graph.out_degree(root);
+    for (PropT iter = 0; sum > 0; ++iter) {
+        IterStats stats{iter, Direction::pull, sum, frontier_edges};
+        sum = 0;
+        frontier_edges = 0;
+        long long active_vertices{};
+        long long edges_scanned{};
+#pragma omp parallel for default(shared) schedule(dynamic, 1024) \
+    reduction(+ : sum, frontier_edges, active_vertices, edges_scanned)
+        for (T v = 0; v < vertex_number; ++v) {
+            if (prefetch_distance > 0 && v + prefetch_distance < vertex_number) {
+                __builtin_prefetch(graph.in_neighbors(v + prefetch_distance).begin());
+            }
+            if (!is_max_prop(depth[v])) {
+                continue;
+            }
+            active_vertices++;
+            auto neighbors = graph.in_neighbors(v);
+            DstT const *neigh = neighbors.begin();
+            int64_t const degree = neighbors.end() - neighbors.begin();
+            for (int64_t j = 0; j < degree; ++j) {
+                if (prefetch_distance > 0 && j + prefetch_distance < degree) {
+                    if constexpr (UseBitmap) {
+                        front.prefetch(get_dst_id(neigh[j + prefetch_distance]));
+                    } else {
+                        __builtin_prefetch(&depth[get_dst_id(neigh[j + prefetch_distance])]);
+                    }
+                }
+                edges_scanned++;
+                T u = get_dst_id(neigh[j]);
+                bool in_frontier;
+                if constexpr (UseBitmap) {
+                    in_frontier = front.get_bit(u);
+                } else {
+                    in_frontier = (depth[u] == iter);
+                }
+                if (in_frontier) {
+                    depth[v] = iter + 1;
+                    if constexpr (UseBitmap) {
+                        next.set_bit_atomic(v);
+                    }
+                    sum++;
+                    frontier_edges += graph.out_degree(v);
+                    break;
+                }
+            }
+        }
+        stats.active_vertices = active_vertices;
+        stats.edges_scanned = edges_scanned;
+        stats.discovered = sum;
+        observer(stats);
+        if constexpr (UseBitmap) {
+            front.swap(next);
+            next.reset();
+        }
+    }
+    return depth;
+}
+
+enum class LoopSchedule : int {
+    static_chunks,
+    dynamic,
+    guided
+};
+
+/**
+ * Knobs of do_parent_bfs: the direction switch thresholds, the chunk of frontier vertices a
+ * top-down step hands out, and how the bottom-up loop over all vertices is scheduled.
+ * tune_bfs (tuning.h) picks them per graph.
+ */
+struct BfsTuning {
+    int alpha = 15;
+    int beta = 18;
+    int push_chunk = 64;
+    LoopSchedule pull_schedule = LoopSchedule::dynamic;
+    int pull_chunk = 1024;
+};
+
+/**
+ * Direction-optimizing BFS (Beamer et al., SC'12) that returns the BFS tree: parent[root] is root
+ * and unreached vertices keep get_max_prop<T>(). Top-down steps claim vertices with
+ * compare_and_swap on parent. Once the edges out of the frontier exceed 1/alpha of the edges
+ * left unexplored, the traversal goes bottom-up over a frontier Bitmap, and it returns to
+ * top-down when the frontier shrinks again and holds fewer than V/beta vertices. The bottom-up
+ * loop runs with schedule(runtime); the caller's run-sched setting is restored on return.
+ */
+template<typename T, typename DstT, typename Observer = NullIterObserver>
+std::vector<T> do_parent_bfs(Graph<T, DstT> const &graph, T root, BfsTuning const &tuning = {},
+                             Observer &&observer = {}) {
+    require_full_storage(graph, "do_parent_bfs");
+#if defined(_OPENMP)
+    omp_sched_t saved_kind;
+    int saved_chunk;
+    omp_get_schedule(&saved_kind, &saved_chunk);
+    omp_sched_t const kinds[] = {omp_sched_static, omp_sched_dynamic, omp_sched_guided};
+    omp_set_schedule(kinds[static_cast<int>(tuning.pull_schedule)], tuning.pull_chunk);
+#endif
+    int const alpha = tuning.alpha;
+    int const beta = tuning.beta;
+    int const push_chunk = tuning.push_chunk;
+    int64_t const vertex_number = graph.get_vertex_number();
+    std::vector<T> parent(vertex_number, get_max_prop<T>());
+    parent[root] = root;
+    std::vector<T> frontier{root};
+    std::vector<T> next_frontier;
+    Bitmap front(vertex_number);
+    Bitmap next(vertex_number);
+    long long edges_to_check = static_cast<long long>(graph.get_offset()[vertex_number]);
+    long long scout_count = graph.out_degree(root);
+    int iter{};
+
+    auto top_down_step = [&]() {
+        IterStats stats{iter++, Direction::push, static_cast<long long>(frontier.size()), scout_count};
+        long long scout{}, edges_scanned{};
+        next_frontier.clear();
+#pragma omp parallel default(shared) reduction(+ : scout, edges_scanned)
+        {
+            std::vector<T> local;
+#pragma omp for schedule(dynamic, push_chunk) nowait
+            for (size_t i = 0; i < frontier.size(); ++i) {
+                T u = frontier[i];
+                for (auto const &w : graph.out_neighbors(u)) {
+                    T v = get_dst_id(w);
+                    edges_scanned++;
+                    if (is_max_prop(parent[v]) && compare_and_swap(parent[v], get_max_prop<T>(), u)) {
+                        local.emplace_back(v);
+                        scout += graph.out_degree(v);
+                    }
+                }
+            }
+#pragma omp critical
+            next_frontier.insert(next_frontier.end(), local.begin(), local.end());
+        }
+        stats.active_vertices = stats.frontier_vertices;
+        stats.edges_scanned = edges_scanned;
+        stats.discovered = static_cast<long long>(next_frontier.size());
+        observer(stats);
+        frontier.swap(next_frontier);
+        return scout;
+    };
+    auto bottom_up_step = [&](long long frontier_size) {
+        IterStats stats{iter++, Direction::pull, frontier_size};
+        long long awake{}, frontier_edges{}, active_vertices{}, edges_scanned{};
+        next.reset();
+#pragma omp parallel for default(shared) schedule(runtime) \
+    reduction(+ : awake, frontier_edges, active_vertices, edges_scanned)
+        for (T v = 0; v < vertex_number; ++v) {
+            if (!is_max_prop(parent[v])) {
+                continue;
+            }
+            active_vertices++;
+            for (auto const &w : graph.in_neighbors(v)) {
+                T u = get_dst_id(w);
+                edges_scanned++;
+                if (front.get_bit(u)) {
+                    parent[v] = u;
+                    next.set_bit_atomic(v);
+                    awake++;
+                    frontier_edges += graph.out_degree(v);
+                    break;
+                }
+            }
+        }
+        stats.active_vertices = active_vertices;
+        stats.edges_scanned = edges_scanned;
+        stats.discovered = awake;
+        observer(stats);
+        front.swap(next);
+        return awake;
+    };
+
+    while (!frontier.empty()) {
+        if (scout_count > edges_to_check / alpha) {
+            graph.build_transpose();    // the bottom-up steps read in_neighbors in parallel
+            front.reset();
+#pragma omp parallel for default(shared)
+            for (size_t i = 0; i < frontier.size(); ++i) {
+                front.set_bit_atomic(frontier[i]);
+            }
+            long long awake = static_cast<long long>(frontier.size());
+            long long old_awake;
+            do {
+                old_awake = awake;
+                awake = bottom_up_step(awake);
+            } while (awake >= old_awake || awake > vertex_number / beta);
+            frontier.clear();
+#pragma omp parallel default(shared)
+            {
+                std::vector<T> local;
+#pragma omp for nowait
+                for (T v = 0; v < vertex_number; ++v) {
+                    if (front.get_bit(v)) {
+                        local.emplace_back(v);
+                    }
+                }
+#pragma omp critical
+                frontier.insert(frontier.end(), local.begin(), local.end());
+            }
+            scout_count = 1;
+        } else {
+            edges_to_check -= scout_count;
+            scout_count = top_down_step();
+        }
+    }
+#if defined(_OPENMP)
+    omp_set_schedule(saved_kind, saved_chunk);
+#endif
+    return parent;
+}
+
 #endif //EXPERIMENT_BFS_H
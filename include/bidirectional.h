@@ -0,0 +1,118 @@
+#ifndef EXPERIMENT_BIDIRECTIONAL_H
+#define EXPERIMENT_BIDIRECTIONAL_H
+
+#include "graph.h"
+#include "bfs.h"
+#include <vector>
+#include <utility>
+
+/**
+ * Point-to-point distance queries by bidirectional BFS: a forward search from the source over
+ * out-edges and a backward search from the target over in-edges, each step expanding the side
+ * whose frontier has fewer edges. The level that first links both searches gives the distance.
+ * On small-world graphs both sides meet after a few short levels, so a query touches a tiny
+ * part of the graph. The depth arrays are allocated once and, after a query, only the entries
+ * it touched are reset, so a searcher should live as long as its thread.
+ */
+template<typename T, typename DstT = T, typename PropT = int>
+class BidirectionalBFS {
+    Graph<T, DstT> const &graph;
+    // index 0 is the forward search, 1 the backward one
+    std::vector<PropT> depth[2];
+    std::vector<T> touched[2];
+    std::vector<T> frontier[2];
+    std::vector<T> next;
+
+    void visit(int side, T v, PropT d) {
+        depth[side][v] = d;
+        touched[side].emplace_back(v);
+    }
+    void reset() {
+        for (int side : {0, 1}) {
+            for (T v : touched[side]) {
+                depth[side][v] = get_max_prop<PropT>();
+            }
+            touched[side].clear();
+        }
+    }
+public:
+    explicit BidirectionalBFS(Graph<T, DstT> const &graph)
+        : graph{graph},
+        depth{std::vector<PropT>(graph.get_vertex_number(), get_max_prop<PropT>()),
+              std::vector<PropT>(graph.get_vertex_number(), get_max_prop<PropT>())} {
+        require_full_storage(graph, "BidirectionalBFS");
+    }
+
+    /**
+     * Length of the shortest path from source to target, get_max_prop<PropT>() if there is none.
+     * The observer gets one IterStats per expanded level, push for the forward search and pull
+     * for the backward one.
+     */
+    template<typename Observer = NullIterObserver>
+    PropT distance(T source, T target, Observer &&observer = {}) {
+        if (source == target) {
+            return 0;
+        }
+        visit(0, source, 0);
+        visit(1, target, 0);
+        frontier[0].assign(1, source);
+        frontier[1].assign(1, target);
+        long long frontier_edges[2] = {static_cast<long long>(graph.out_degree(source)),
+                                       static_cast<long long>(graph.in_degree(target))};
+        PropT best = get_max_prop<PropT>();
+        for (int iter = 0; is_max_prop(best) && !frontier[0].empty() && !frontier[1].empty(); ++iter) {
+            int side = frontier_edges[0] <= frontier_edges[1] ? 0 : 1;
+            auto &own = depth[side];
+            auto const &other = depth[1 - side];
+            IterStats stats{iter, side ? Direction::pull : Direction::push,
+                            static_cast<long long>(frontier[side].size()), frontier_edges[side]};
+            next.clear();
+            long long next_edges{};
+            for (T u : frontier[side]) {
+                stats.active_vertices++;
+                auto neighbors = side ? graph.in_neighbors(u) : graph.out_neighbors(u);
+                for (auto const &w : neighbors) {
+                    T v = get_dst_id(w);
+                    stats.edges_scanned++;
+                    // the sentinel is -1 for signed PropT, so it cannot take part in a min
+                    if (!is_max_prop(other[v]) && (is_max_prop(best) || own[u] + 1 + other[v] < best)) {
+                        best = own[u] + 1 + other[v];
+                    }
+                    if (is_max_prop(own[v])) {
+                        visit(side, v, own[u] + 1);
+                        next.emplace_back(v);
+                        next_edges += side ? graph.in_degree(v) : graph.out_degree(v);
+                        stats.discovered++;
+                    }
+                }
+            }
+            std::swap(frontier[side], next);
+            frontier_edges[side] = next_edges;
+            observer(stats);
+        }
+        reset();
+        return best;
+    }
+};
+
+/**
+ * Throughput mode: the queries are spread over the threads, each with a searcher of its own.
+ */
+template<typename T, typename DstT, typename PropT = int>
+std::vector<PropT> bidirectional_distances(Graph<T, DstT> const &graph,
+                                           std::vector<std::pair<T, T>> const &queries) {
+    std::vector<PropT> distances(queries.size());
+    // built once here rather than by the first query, inside the parallel region
+    graph.build_transpose();
+#pragma omp parallel default(shared)
+    {
+        BidirectionalBFS<T, DstT, PropT> search{graph};
+#pragma omp for schedule(dynamic, 1)
+        for (size_t i = 0; i < queries.size(); ++i) {
+            distances[i] = search.distance(queries[i].first, queries[i].second);
+        }
+    }
+    return distances;
+}
+
+#endif //EXPERIMENT_BIDIRECTIONAL_H
@@ -37,6 +37,14 @@ class Bitmap {
     return (start_[word_offset(pos)] >> bit_offset(pos)) & 1l;
   }
 
+  void prefetch(size_t pos) const {
+    __builtin_prefetch(&start_[word_offset(pos)]);
+  }
+
+  uint64_t *data() { return start_; }
+  const uint64_t *data() const { return start_; }
+  size_t num_words() const { return end_ - start_; }
+
   void swap(Bitmap &other) {
     std::swap(start_, other.start_);
     std::swap(end_, other.end_);
@@ -2,65 +2,197 @@
 
 #include "graph.h"
 #include "atomics.h"
+#include "accumulator.h"
+#include "edge_stream.h"
 #include <string>
 #include <vector>
-#include <sstream>
-#include <fstream>
 #include <random>
 #include <algorithm>
+#include <numeric>
+#include <cassert>
+
+/**
+ * How a symmetric graph keeps its edges: both directions, or only (u, v) with u < v, which
+ * halves the CSR and its construction (see Graph::upper_triangular_graph). Self loops are
+ * dropped in the latter.
+ */
+enum class SymmetricStorage { full, upper };
 
 template<typename T, typename DstT = T>
 class Builder {
 public:
     typedef std::vector<std::pair<T, DstT>> EdgeList;
+    typedef typename Graph<T, DstT>::offset_t offset_t;
 private:
     std::string graph_file;
     bool symmetric;
-    EdgeList read_edge_list();
+    bool upper;
+    EdgeList read_edge_list(std::vector<offset_t> &out_degrees);
+    Graph<T, DstT> assemble_csr(EdgeList const &el, std::vector<offset_t> const &out_degrees);
 public:
     template<typename StrT>
-    Builder(StrT &&graph_file, bool symmetric=false)
-        : graph_file{std::forward<StrT>(graph_file)}, symmetric{symmetric} {}
+    Builder(StrT &&graph_file, bool symmetric=false, SymmetricStorage storage=SymmetricStorage::full)
+        : graph_file{std::forward<StrT>(graph_file)}, symmetric{symmetric},
+        upper{symmetric && storage == SymmetricStorage::upper} {}
+    /**
+     * For edge lists that are already in memory (see build_csr(EdgeList)).
+     */
+    explicit Builder(bool symmetric=false, SymmetricStorage storage=SymmetricStorage::full)
+        : symmetric{symmetric}, upper{symmetric && storage == SymmetricStorage::upper} {}
+    /**
+     * CSR of the graph file: a text edge list (plain, .gz or .zst) or a binary one (.bel).
+     * Directed graphs only get their out-CSR here, the in-CSR is built on first use
+     * (see Graph::build_transpose).
+     */
     Graph<T, DstT> build_csr();
+    /**
+     * CSR of an in-memory edge list, e.g. from generate_rmat. Reverse edges are added here
+     * in symmetric mode, or every edge is turned upwards in upper storage. vertex_number
+     * defaults to the largest id + 1; generators pass theirs, so that trailing isolated
+     * vertices are kept.
+     */
+    Graph<T, DstT> build_csr(EdgeList el, int64_t vertex_number = -1);
 };
 
+/**
+ * Reads and parses the file as a pipeline (see edge_stream.h): while the reader thread fetches
+ * the next blocks, every parser thread turns its block into edges and counts degrees and the
+ * largest id into arrays of its own, which are merged once the file is consumed.
+ */
 template<typename T, typename DstT>
-typename Builder<T, DstT>::EdgeList Builder<T, DstT>::read_edge_list() {
-    std::ifstream in(this->graph_file, std::ios::in);
-    assert(in.is_open());
-    std::vector<std::pair<T, T>> el;
-    el.reserve(1000000);
-    std::string line;
+typename Builder<T, DstT>::EdgeList Builder<T, DstT>::read_edge_list(std::vector<offset_t> &out_degrees) {
+    struct Part {
+        EdgeList edges;
+        std::vector<offset_t> out_degrees;
+        T max_idx{};
+    };
+    auto count = [](std::vector<offset_t> &degrees, T v) {
+        if (static_cast<size_t>(v) >= degrees.size()) {
+            degrees.resize(std::max<size_t>(v + 1, degrees.size() * 2), 0);
+        }
+        degrees[v]++;
+    };
+    int workers = parser_threads();
+    std::vector<Part> parts(workers);
+    parse_edge_file(graph_file, workers, [&](int thread, char const *begin, char const *end) {
+        Part &part = parts[thread];
+        parse_edge_lines<T>(begin, end, [&](T u, T v) {
+            part.max_idx = std::max({part.max_idx, u, v});
+            if (upper) {
+                if (u != v) {
+                    part.edges.emplace_back(std::min(u, v), DstT{std::max(u, v)});
+                    count(part.out_degrees, std::min(u, v));
+                }
+                return;
+            }
+            part.edges.emplace_back(u, DstT{v});
+            count(part.out_degrees, u);
+            if (symmetric && u != v) {
+                part.edges.emplace_back(v, DstT{u});
+                count(part.out_degrees, v);
+            }
+        });
+    });
 
-    while (std::getline(in, line)) {
-        if (line[0] == '#')
-            continue;   // skip commented lines
-        std::istringstream iss(line);
-        T u, v;
-        iss >> u >> v;
-        el.emplace_back(u, DstT{v});
-        if (symmetric && u != v)
-            el.emplace_back(v, DstT{u});
+    T max_idx{};
+    std::vector<size_t> part_offset(workers + 1, 0);
+    for (int i = 0; i < workers; ++i) {
+        max_idx = std::max(max_idx, parts[i].max_idx);
+        part_offset[i + 1] = part_offset[i] + parts[i].edges.size();
+    }
+    int64_t vertex_number = static_cast<int64_t>(max_idx) + 1;
+    out_degrees.assign(vertex_number, 0);
+    EdgeList el(part_offset[workers]);
+#pragma omp parallel default(shared)
+    {
+#pragma omp for nowait
+        for (int64_t v = 0; v < vertex_number; ++v) {
+            for (auto const &part : parts) {
+                if (static_cast<size_t>(v) < part.out_degrees.size()) {
+                    out_degrees[v] += part.out_degrees[v];
+                }
+            }
+        }
+#pragma omp for schedule(dynamic, 1)
+        for (int i = 0; i < workers; ++i) {
+            std::copy(parts[i].edges.begin(), parts[i].edges.end(), el.begin() + part_offset[i]);
+            EdgeList{}.swap(parts[i].edges);
+        }
     }
     return el;
 }
 
 template<typename T, typename DstT>
 Graph<T, DstT> Builder<T, DstT>::build_csr() {
-    typedef typename Graph<T, DstT>::offset_t offset_t;
-    EdgeList el = read_edge_list();
-    int max_idx{};
+    if (has_extension(graph_file, ".bel")) {
+        int64_t vertex_number;
+        EdgeList el = read_binary_edges<std::pair<T, DstT>>(graph_file, vertex_number);
+        return build_csr(std::move(el), vertex_number);
+    }
+    std::vector<offset_t> out_degrees;
+    EdgeList el = read_edge_list(out_degrees);
+    return assemble_csr(el, out_degrees);
+}
+
+template<typename T, typename DstT>
+Graph<T, DstT> Builder<T, DstT>::build_csr(EdgeList el, int64_t vertex_number) {
+    T max_idx{};
+#pragma omp parallel for default(shared) reduction(max : max_idx)
     for (size_t i = 0; i < el.size(); ++i) {
-        max_idx = std::max(max_idx, el[i].first);
-        max_idx = std::max(max_idx, get_dst_id(el[i].second));
+        max_idx = std::max({max_idx, el[i].first, get_dst_id(el[i].second)});
+    }
+    if (upper) {
+#pragma omp parallel for default(shared)
+        for (size_t i = 0; i < el.size(); ++i) {
+            T v = get_dst_id(el[i].second);
+            if (v < el[i].first) {
+                get_dst_id(el[i].second) = el[i].first;
+                el[i].first = v;
+            }
+        }
+        std::erase_if(el, [](auto const &edge) { return edge.first == get_dst_id(edge.second); });
+    } else if (symmetric) {
+        size_t const n = el.size();
+        std::vector<size_t> reverse_pos(n + 1, 0);
+#pragma omp parallel for default(shared)
+        for (size_t i = 0; i < n; ++i) {
+            reverse_pos[i + 1] = (el[i].first != get_dst_id(el[i].second));
+        }
+        std::partial_sum(reverse_pos.begin(), reverse_pos.end(), reverse_pos.begin());
+        el.resize(n + reverse_pos[n]);
+#pragma omp parallel for default(shared)
+        for (size_t i = 0; i < n; ++i) {
+            if (reverse_pos[i + 1] != reverse_pos[i]) {
+                auto &reverse = el[n + reverse_pos[i]];
+                reverse = el[i];
+                reverse.first = get_dst_id(el[i].second);
+                get_dst_id(reverse.second) = el[i].first;
+            }
+        }
     }
-    int64_t vertex_number = max_idx + 1;
+    if (vertex_number < 0) {
+        vertex_number = static_cast<int64_t>(max_idx) + 1;
+    }
+    assert(static_cast<int64_t>(max_idx) < vertex_number);
     std::vector<offset_t> out_degrees(vertex_number, 0);
-#pragma omp parallel for default(none) shared(el, out_degrees)
-    for (size_t i = 0; i < el.size(); ++i) {
-        auto const &edge = el[i];
-        fetch_and_add(out_degrees[edge.first], 1);
+    ScatterAccumulator<T, offset_t> out_acc{out_degrees.data(), vertex_number};
+#pragma omp parallel default(shared)
+    {
+        for (size_t begin = 0; begin < el.size(); begin += accumulator_round_updates) {
+            size_t end = std::min(el.size(), begin + accumulator_round_updates);
+#pragma omp for nowait
+            for (size_t i = begin; i < end; ++i) {
+                out_acc.add(el[i].first, 1);
+            }
+            out_acc.apply();
+        }
     }
+    return assemble_csr(el, out_degrees);
+}
+
+template<typename T, typename DstT>
+Graph<T, DstT> Builder<T, DstT>::assemble_csr(EdgeList const &el, std::vector<offset_t> const &out_degrees) {
+    int64_t vertex_number = out_degrees.size();
     offset_t *out_offset = new offset_t[vertex_number + 1];
     offset_t curr{};
     for (size_t i = 0; i < vertex_number; ++i) {
@@ -83,35 +215,12 @@ Graph<T, DstT> Builder<T, DstT>::build_csr() {
             return get_dst_id(lhs) < get_dst_id(rhs);
         });
     }
+    delete[] tmp;
+    if (upper) {
+        return Graph<T, DstT>::upper_triangular_graph(vertex_number, out_offset, out_neigh);
+    }
     if (symmetric) {
-        delete[] tmp;
         return {vertex_number, out_offset, out_neigh};
     }
-    std::vector<T> in_degrees(vertex_number, 0);
-#pragma omp parallel for default(none) shared(el, in_degrees)
-    for (size_t i = 0; i < el.size(); ++i) {
-        auto const &edge = el[i];
-        fetch_and_add(in_degrees[get_dst_id(edge.second)], 1);
-    }
-    offset_t *in_offset = new offset_t[vertex_number + 1];
-    curr = 0;
-    for (size_t i = 0; i < vertex_number + 1; ++i) {
-        in_offset[i] = curr;
-        curr += in_degrees[i];
-    }
-    DstT *in_neigh = new DstT[edge_number];
-    std::copy(in_offset, in_offset + (vertex_number + 1), tmp);
-#pragma omp parallel for default(none) shared(el, tmp, in_neigh)
-    for (size_t i = 0; i < el.size(); ++i) {
-        auto const &edge = el[i];
-        int write_pos = fetch_and_add(tmp[get_dst_id(edge.second)], 1);
-        get_dst_id(in_neigh[write_pos]) = edge.first;
-    }
-    for (size_t i = 0; i < vertex_number; ++i) {
-        std::sort(&in_neigh[in_offset[i]], &in_neigh[in_offset[i+1]], [](DstT const &lhs, DstT const &rhs) {
-            return get_dst_id(lhs) < get_dst_id(rhs);
-        });
-    }
-    delete[] tmp;
-    return {vertex_number, out_offset, out_neigh, in_offset, in_neigh};
+    return {vertex_number, out_offset, out_neigh, true};
 }
@@ -0,0 +1,340 @@
+#ifndef EXPERIMENT_CACHE_H
+#define EXPERIMENT_CACHE_H
+
+#include "graph.h"
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <optional>
+#include <iostream>
+#include <algorithm>
+#include <utility>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * Content-addressed cache of derived graphs. A derived graph is what a chain of transformations
+ * (squeeze_graph, simplify_graph, reorder_by_degree, ...) makes of the graph of an input file,
+ * together with the id maps the chain produced. It is stored under a key hashed from the bytes of
+ * the input file and the name of the chain, so editing either one is a miss rather than a stale
+ * hit, and a repeated experiment loads the result instead of recomputing it.
+ */
+
+constexpr uint64_t fnv_offset_basis = 0xcbf29ce484222325ull;
+constexpr uint64_t fnv_prime = 0x100000001b3ull;
+
+inline uint64_t fnv1a(void const *data, size_t size, uint64_t hash = fnv_offset_basis) {
+    auto const *p = static_cast<unsigned char const *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ p[i]) * fnv_prime;
+    }
+    return hash;
+}
+
+constexpr size_t content_hash_block = 16 << 20;
+
+/**
+ * FNV-1a of every 16 MiB block of the file, in parallel, then FNV-1a of the block hashes and
+ * the size. Returns std::nullopt if the file cannot be read.
+ */
+inline std::optional<uint64_t> file_content_hash(std::string const &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    struct stat st{};
+    fstat(fd, &st);
+    size_t size = st.st_size;
+    void *mapped = (size > 0) ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return std::nullopt;
+    }
+    auto const *data = static_cast<char const *>(mapped);
+    size_t const blocks = (size + content_hash_block - 1) / content_hash_block;
+    std::vector<uint64_t> block_hashes(blocks);
+#pragma omp parallel for default(shared) schedule(dynamic, 1)
+    for (size_t b = 0; b < blocks; ++b) {
+        size_t begin = b * content_hash_block;
+        block_hashes[b] = fnv1a(data + begin, std::min(size, begin + content_hash_block) - begin);
+    }
+    if (mapped) {
+        munmap(mapped, size);
+    }
+    uint64_t hash = fnv1a(block_hashes.data(), blocks * sizeof(uint64_t));
+    return fnv1a(&size, sizeof(size), hash);
+}
+
+/**
+ * A graph and the id maps of the chain that derived it, in the order the chain returns them,
+ * e.g. {vertex_map, vertex_remap} of squeeze_graph or {new_ids, new_ids_remap} of
+ * reorder_by_degree. The maps translate results back to the ids of the input file.
+ */
+template<typename T, typename DstT = T>
+struct DerivedGraph {
+    Graph<T, DstT> graph;
+    std::vector<std::vector<T>> id_maps;
+};
+
+/**
+ * Cache file layout: this header, the chain name, the length of each id map, then 64-byte
+ * aligned sections: out_offset, out_neigh, in_offset and in_neigh when stored, and the id maps.
+ * All arrays are in memory representation, so the file can be mapped and used in place.
+ */
+struct DerivedGraphHeader {
+    char magic[8];
+    uint64_t key;
+    uint64_t vertex_bytes;
+    uint64_t dst_bytes;
+    uint64_t offset_bytes;
+    int64_t vertex_number;
+    uint64_t out_edges;
+    uint64_t in_edges;
+    uint64_t map_number;
+    uint64_t chain_bytes;
+    uint8_t directed;
+    uint8_t upper_triangular;
+    uint8_t has_in;
+    uint8_t padding[5];
+};
+
+constexpr char derived_graph_magic[8] = {'D', 'E', 'R', 'I', 'V', 'E', 'D', '1'};
+constexpr size_t derived_section_align = 64;
+
+/**
+ * Byte offsets of the sections of a cache file, and its size.
+ */
+struct DerivedGraphLayout {
+    size_t out_offset, out_neigh, in_offset, in_neigh;
+    std::vector<size_t> maps;
+    size_t size;
+
+    DerivedGraphLayout(DerivedGraphHeader const &header, std::vector<uint64_t> const &map_lengths) {
+        auto align = [](size_t pos) { return (pos + derived_section_align - 1) / derived_section_align * derived_section_align; };
+        size_t pos = sizeof(DerivedGraphHeader) + header.chain_bytes + header.map_number * sizeof(uint64_t);
+        auto section = [&](size_t bytes) {
+            size_t begin = align(pos);
+            pos = begin + bytes;
+            return begin;
+        };
+        out_offset = section((header.vertex_number + 1) * header.offset_bytes);
+        out_neigh = section(header.out_edges * header.dst_bytes);
+        in_offset = section(header.has_in ? (header.vertex_number + 1) * header.offset_bytes : 0);
+        in_neigh = section(header.in_edges * header.dst_bytes);
+        for (uint64_t length : map_lengths) {
+            maps.emplace_back(section(length * header.vertex_bytes));
+        }
+        size = pos;
+    }
+};
+
+/**
+ * Key of the chain applied to the graph of input_file. The chain name has to tell apart
+ * everything that changes the result, Builder options included ("symmetric,squeeze,...").
+ */
+template<typename T, typename DstT = T>
+std::optional<uint64_t> derived_graph_key(std::string const &input_file, std::string const &chain) {
+    auto content = file_content_hash(input_file);
+    if (!content) {
+        return std::nullopt;
+    }
+    uint64_t sizes[3] = {sizeof(T), sizeof(DstT), sizeof(typename Graph<T, DstT>::offset_t)};
+    uint64_t hash = fnv1a(&*content, sizeof(uint64_t));
+    hash = fnv1a(sizes, sizeof(sizes), hash);
+    return fnv1a(chain.data(), chain.size(), hash);
+}
+
+inline std::filesystem::path derived_graph_path(std::filesystem::path const &cache_dir, uint64_t key) {
+    char name[24];
+    std::snprintf(name, sizeof(name), "%016llx.csr", static_cast<unsigned long long>(key));
+    return cache_dir / name;
+}
+
+/**
+ * Write the derived graph to path, through a temporary file renamed into place so that a
+ * concurrent reader never sees half of it. A directed graph whose transpose was not built is
+ * stored without it, as are upper triangular graphs, which rebuild it on use. Returns false if
+ * the file could not be written.
+ */
+template<typename T, typename DstT>
+bool save_derived_graph(std::filesystem::path const &path, uint64_t key, std::string const &chain,
+                        DerivedGraph<T, DstT> const &derived) {
+    typedef typename Graph<T, DstT>::offset_t offset_t;
+    auto const &graph = derived.graph;
+    int64_t const vertex_number = graph.get_vertex_number();
+    offset_t const *out_offset = graph.get_offset();
+    bool const has_in = graph.is_directed() && graph.has_transpose() && !graph.is_upper_triangular();
+    DerivedGraphHeader header{};
+    std::copy(std::begin(derived_graph_magic), std::end(derived_graph_magic), header.magic);
+    header.key = key;
+    header.vertex_bytes = sizeof(T);
+    header.dst_bytes = sizeof(DstT);
+    header.offset_bytes = sizeof(offset_t);
+    header.vertex_number = vertex_number;
+    header.out_edges = out_offset[vertex_number] - out_offset[0];
+    header.in_edges = has_in ? graph.get_in_offset()[vertex_number] - graph.get_in_offset()[0] : 0;
+    header.map_number = derived.id_maps.size();
+    header.chain_bytes = chain.size();
+    header.directed = graph.is_directed();
+    header.upper_triangular = graph.is_upper_triangular();
+    header.has_in = has_in;
+    std::vector<uint64_t> map_lengths;
+    for (auto const &map : derived.id_maps) {
+        map_lengths.emplace_back(map.size());
+    }
+    DerivedGraphLayout layout{header, map_lengths};
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    std::string tmp = path.string() + ".tmp" + std::to_string(::getpid());
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool complete = ::ftruncate(fd, layout.size) == 0;
+    auto write_at = [fd, &complete](void const *buf, size_t n, size_t pos) {
+        auto const *p = static_cast<char const *>(buf);
+        while (complete && n > 0) {
+            ssize_t done = ::pwrite(fd, p, n, pos);
+            if (done <= 0) {
+                complete = false;
+                break;
+            }
+            p += done;
+            pos += done;
+            n -= done;
+        }
+    };
+    write_at(&header, sizeof(header), 0);
+    write_at(chain.data(), chain.size(), sizeof(header));
+    write_at(map_lengths.data(), map_lengths.size() * sizeof(uint64_t), sizeof(header) + chain.size());
+    // the neighborhoods of vertex 0 start where the neighbor arrays do
+    write_at(out_offset, (vertex_number + 1) * sizeof(offset_t), layout.out_offset);
+    write_at(graph.out_neighbors(0).begin() - out_offset[0], header.out_edges * sizeof(DstT), layout.out_neigh);
+    if (has_in) {
+        offset_t const *in_offset = graph.get_in_offset();
+        write_at(in_offset, (vertex_number + 1) * sizeof(offset_t), layout.in_offset);
+        write_at(graph.in_neighbors(0).begin() - in_offset[0], header.in_edges * sizeof(DstT), layout.in_neigh);
+    }
+    for (size_t i = 0; i < derived.id_maps.size(); ++i) {
+        write_at(derived.id_maps[i].data(), map_lengths[i] * sizeof(T), layout.maps[i]);
+    }
+    ::close(fd);
+    if (complete) {
+        std::filesystem::rename(tmp, path, ec);
+        complete = !ec;
+    }
+    if (!complete) {
+        std::filesystem::remove(tmp, ec);
+    }
+    return complete;
+}
+
+/**
+ * Map the cache file at path and copy its arrays out in parallel. std::nullopt if there is no
+ * such file, or it was written for another key, chain or vertex type, or is truncated.
+ */
+template<typename T, typename DstT = T>
+std::optional<DerivedGraph<T, DstT>> load_derived_graph(std::filesystem::path const &path, uint64_t key,
+                                                        std::string const &chain) {
+    typedef typename Graph<T, DstT>::offset_t offset_t;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    struct stat st{};
+    fstat(fd, &st);
+    size_t const size = st.st_size;
+    void *mapped = (size >= sizeof(DerivedGraphHeader)) ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return std::nullopt;
+    }
+    auto const *data = static_cast<char const *>(mapped);
+    DerivedGraphHeader header{};
+    std::memcpy(&header, data, sizeof(header));
+    size_t const prefix = sizeof(header) + header.chain_bytes + header.map_number * sizeof(uint64_t);
+    if (!std::equal(std::begin(derived_graph_magic), std::end(derived_graph_magic), header.magic)
+        || header.key != key || header.vertex_bytes != sizeof(T) || header.dst_bytes != sizeof(DstT)
+        || header.offset_bytes != sizeof(offset_t) || header.chain_bytes != chain.size() || prefix > size
+        || chain.compare(0, chain.size(), data + sizeof(header), header.chain_bytes) != 0) {
+        munmap(mapped, size);
+        return std::nullopt;
+    }
+    std::vector<uint64_t> map_lengths(header.map_number);
+    std::memcpy(map_lengths.data(), data + sizeof(header) + header.chain_bytes, header.map_number * sizeof(uint64_t));
+    DerivedGraphLayout layout{header, map_lengths};
+    if (layout.size > size) {
+        munmap(mapped, size);
+        return std::nullopt;
+    }
+
+    // parallel copy, the page faults of the mapping included
+    auto copy_out = [data](size_t pos, size_t bytes, void *dst) {
+        size_t const chunks = (bytes + content_hash_block - 1) / content_hash_block;
+#pragma omp parallel for default(shared) schedule(dynamic, 1)
+        for (size_t c = 0; c < chunks; ++c) {
+            size_t begin = c * content_hash_block;
+            std::memcpy(static_cast<char *>(dst) + begin, data + pos + begin,
+                        std::min(bytes, begin + content_hash_block) - begin);
+        }
+    };
+    int64_t const vertex_number = header.vertex_number;
+    offset_t *out_offset = new offset_t[vertex_number + 1];
+    DstT *out_neigh = new DstT[header.out_edges];
+    copy_out(layout.out_offset, (vertex_number + 1) * sizeof(offset_t), out_offset);
+    copy_out(layout.out_neigh, header.out_edges * sizeof(DstT), out_neigh);
+    DerivedGraph<T, DstT> derived;
+    if (!header.directed) {
+        derived.graph = Graph<T, DstT>{vertex_number, out_offset, out_neigh};
+    } else if (header.upper_triangular) {
+        derived.graph = Graph<T, DstT>::upper_triangular_graph(vertex_number, out_offset, out_neigh);
+    } else if (!header.has_in) {
+        derived.graph = Graph<T, DstT>{vertex_number, out_offset, out_neigh, true};
+    } else {
+        offset_t *in_offset = new offset_t[vertex_number + 1];
+        DstT *in_neigh = new DstT[header.in_edges];
+        copy_out(layout.in_offset, (vertex_number + 1) * sizeof(offset_t), in_offset);
+        copy_out(layout.in_neigh, header.in_edges * sizeof(DstT), in_neigh);
+        derived.graph = Graph<T, DstT>{vertex_number, out_offset, out_neigh, in_offset, in_neigh};
+    }
+    for (size_t i = 0; i < map_lengths.size(); ++i) {
+        auto &map = derived.id_maps.emplace_back(map_lengths[i]);
+        copy_out(layout.maps[i], map_lengths[i] * sizeof(T), map.data());
+    }
+    munmap(mapped, size);
+    return derived;
+}
+
+/**
+ * The derived graph of chain on input_file from cache_dir, or derive() stored there on a miss.
+ * derive() returns a DerivedGraph<T, DstT> and is only called on a miss. A cache that cannot be
+ * written is reported and otherwise ignored. Clearing the cache is removing cache_dir.
+ */
+template<typename T, typename DstT = T, typename Derive>
+DerivedGraph<T, DstT> cached_graph(std::filesystem::path const &cache_dir, std::string const &input_file,
+                                   std::string const &chain, Derive &&derive) {
+    auto key = derived_graph_key<T, DstT>(input_file, chain);
+    if (!key) {
+        return derive();
+    }
+    auto path = derived_graph_path(cache_dir, *key);
+    if (auto cached = load_derived_graph<T, DstT>(path, *key, chain)) {
+        std::clog << "Cache Hit: " << path.string() << " (" << chain << ")" << std::endl;
+        return std::move(*cached);
+    }
+    DerivedGraph<T, DstT> derived = derive();
+    if (save_derived_graph(path, *key, chain, derived)) {
+        std::clog << "Cache Stored: " << path.string() << " (" << chain << ")" << std::endl;
+    } else {
+        std::clog << "Cache Not Writable: " << path.string() << std::endl;
+    }
+    return derived;
+}
+
+#endif //EXPERIMENT_CACHE_H
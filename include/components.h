@@ -0,0 +1,147 @@
+#ifndef EXPERIMENT_COMPONENTS_H
+#define EXPERIMENT_COMPONENTS_H
+
+#include "graph.h"
+#include "atomics.h"
+#include <vector>
+#include <random>
+#include <numeric>
+#include <unordered_map>
+
+/**
+ * Connected components with Afforest (Sutton et al., IPDPS'18): a few rounds of linking
+ * one sampled neighbor per vertex already put most vertices into the giant component,
+ * after which only vertices outside of it process their remaining edges. The union-find
+ * is lock-free and always hooks the higher label under the lower one via compare_and_swap.
+ * Directed graphs get weakly connected components, i.e. in-edges are linked as well.
+ * Upper triangular graphs keep an edge at its lower end only, so vertices of the sampled
+ * component still link their stored edges to vertices outside of it, and no transpose is built.
+ */
+
+template<typename T>
+void link_vertices(T u, T v, std::vector<T> &comp) {
+    T p1 = comp[u];
+    T p2 = comp[v];
+    while (p1 != p2) {
+        T high = std::max(p1, p2);
+        T low = std::min(p1, p2);
+        T p_high = comp[high];
+        if ((p_high == low) || (p_high == high && compare_and_swap(comp[high], high, low))) {
+            break;
+        }
+        p1 = comp[comp[high]];
+        p2 = comp[low];
+    }
+}
+
+template<typename T>
+void compress_components(std::vector<T> &comp) {
+#pragma omp parallel for default(none) shared(comp) schedule(dynamic, 16384)
+    for (size_t n = 0; n < comp.size(); ++n) {
+        while (comp[n] != comp[comp[n]]) {
+            comp[n] = comp[comp[n]];
+        }
+    }
+}
+
+template<typename T>
+T sample_frequent_element(std::vector<T> const &comp, int num_samples = 1024) {
+    std::unordered_map<T, int> counts(32);
+    std::mt19937 rng(27491095);
+    std::uniform_int_distribution<size_t> dist(0, comp.size() - 1);
+    for (int i = 0; i < num_samples; ++i) {
+        counts[comp[dist(rng)]]++;
+    }
+    auto most_frequent = std::max_element(counts.begin(), counts.end(),
+        [](auto const &lhs, auto const &rhs) { return lhs.second < rhs.second; });
+    return most_frequent->first;
+}
+
+template<typename T, typename DstT>
+std::vector<T> afforest(Graph<T, DstT> const &graph, int neighbor_rounds = 2) {
+    std::vector<T> comp(graph.get_vertex_number());
+    std::iota(comp.begin(), comp.end(), 0);
+    for (int r = 0; r < neighbor_rounds; ++r) {
+#pragma omp parallel for default(none) shared(graph, comp, r) schedule(dynamic, 16384)
+        for (T u = 0; u < graph.get_vertex_number(); ++u) {
+            if (graph.out_degree(u) > r) {
+                link_vertices(u, static_cast<T>(get_dst_id(*(graph.out_neighbors(u).begin() + r))), comp);
+            }
+        }
+        compress_components(comp);
+    }
+    if (comp.empty()) {
+        return comp;
+    }
+    T c = sample_frequent_element(comp);
+    if (graph.is_directed() && !graph.is_upper_triangular()) {
+        graph.build_transpose();    // the in-neighbors are linked in the parallel loop below
+    }
+#pragma omp parallel for default(none) shared(graph, comp, c, neighbor_rounds) schedule(dynamic, 16384)
+    for (T u = 0; u < graph.get_vertex_number(); ++u) {
+        auto neighbors = graph.out_neighbors(u);
+        auto rest = neighbors.begin() + std::min<int64_t>(neighbor_rounds, graph.out_degree(u));
+        if (comp[u] == c) {
+            if (graph.is_upper_triangular()) {
+                for (auto it = rest; it != neighbors.end(); ++it) {
+                    if (comp[get_dst_id(*it)] != c) {
+                        link_vertices(u, static_cast<T>(get_dst_id(*it)), comp);
+                    }
+                }
+            }
+            continue;
+        }
+        for (auto it = rest; it != neighbors.end(); ++it) {
+            link_vertices(u, static_cast<T>(get_dst_id(*it)), comp);
+        }
+        if (graph.is_directed() && !graph.is_upper_triangular()) {
+            for (auto const &v : graph.in_neighbors(u)) {
+                link_vertices(u, static_cast<T>(get_dst_id(v)), comp);
+            }
+        }
+    }
+    compress_components(comp);
+    return comp;
+}
+
+/**
+ * Number of vertices per component, indexed by component label.
+ */
+template<typename T>
+std::vector<int64_t> component_sizes(std::vector<T> const &comp) {
+    std::vector<int64_t> sizes(comp.size(), 0);
+#pragma omp parallel for default(none) shared(comp, sizes)
+    for (size_t n = 0; n < comp.size(); ++n) {
+        fetch_and_add(sizes[comp[n]], 1);
+    }
+    return sizes;
+}
+
+template<typename T>
+T largest_component(std::vector<int64_t> const &sizes) {
+    return static_cast<T>(std::distance(sizes.begin(), std::max_element(sizes.begin(), sizes.end())));
+}
+
+/**
+ * pick_sources restricted to one component, e.g. the giant one.
+ */
+template<typename T, typename DstT>
+std::vector<T> pick_sources(Graph<T, DstT> const &graph, int n, std::vector<T> const &comp, T label) {
+    std::vector<T> members;
+    for (T u = 0; u < graph.get_vertex_number(); ++u) {
+        if (comp[u] == label && graph.out_degree(u) > 0) {
+            members.emplace_back(u);
+        }
+    }
+    assert(!members.empty());
+    std::random_device rd;
+    std::mt19937 rng(rd());
+    std::uniform_int_distribution<size_t> dist(0, members.size() - 1);
+    std::vector<T> sources; sources.reserve(n);
+    for (int i{}; i < n; ++i) {
+        sources.emplace_back(members[dist(rng)]);
+    }
+    return sources;
+}
+
+#endif //EXPERIMENT_COMPONENTS_H
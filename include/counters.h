@@ -0,0 +1,217 @@
+#ifndef EXPERIMENT_COUNTERS_H
+#define EXPERIMENT_COUNTERS_H
+
+#include "bfs.h"
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <utility>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum class Counter : size_t {
+    cycles,
+    instructions,
+    llc_misses,
+    dtlb_misses,
+    backend_stalls,   // stalled-cycles-backend, the portable proxy for memory-bound stalls
+    num_counters
+};
+
+constexpr size_t num_counters = static_cast<size_t>(Counter::num_counters);
+
+inline char const *counter_name(size_t i) {
+    static constexpr char const *names[num_counters] = {
+        "cycles", "instructions", "llc-misses", "dtlb-misses", "backend-stalls"
+    };
+    return names[i];
+}
+
+/**
+ * Counter readings; an entry of -1 marks an event the machine or kernel does not provide.
+ */
+struct CounterValues {
+    std::array<int64_t, num_counters> value{};
+
+    int64_t operator[](Counter c) const { return value[static_cast<size_t>(c)]; }
+    CounterValues &operator+=(CounterValues const &other) {
+        for (size_t i = 0; i < num_counters; ++i) {
+            value[i] = (value[i] < 0 || other.value[i] < 0) ? -1 : value[i] + other.value[i];
+        }
+        return *this;
+    }
+    CounterValues operator-(CounterValues const &other) const {
+        CounterValues diff;
+        for (size_t i = 0; i < num_counters; ++i) {
+            diff.value[i] = (value[i] < 0 || other.value[i] < 0) ? -1 : value[i] - other.value[i];
+        }
+        return diff;
+    }
+};
+
+inline std::ostream &operator<<(std::ostream &out, CounterValues const &values) {
+    for (size_t i = 0; i < num_counters; ++i) {
+        out << (i ? " " : "") << counter_name(i) << "=";
+        if (values.value[i] < 0) {
+            out << "n/a";
+        } else {
+            out << values.value[i];
+        }
+    }
+    return out;
+}
+
+/**
+ * Hardware counters of the calling thread via perf_event_open. Every event is opened on its
+ * own, so an event that is missing (e.g. backend stalls on many Intel parts, or everything
+ * inside a container with perf_event_paranoid > 2) only blanks out that column. Counts are
+ * scaled by enabled/running time in case the kernel multiplexes them.
+ */
+class PerfCounters {
+private:
+    std::array<int, num_counters> fds;
+public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(PerfCounters const &) = delete;
+    PerfCounters &operator=(PerfCounters const &) = delete;
+
+    [[nodiscard]] bool is_available() const {
+        return std::any_of(fds.begin(), fds.end(), [](int fd) { return fd >= 0; });
+    }
+    void start();
+    void stop();
+    [[nodiscard]] CounterValues read() const;
+};
+
+#if defined(__linux__)
+inline PerfCounters::PerfCounters() {
+    static constexpr std::pair<uint32_t, uint64_t> events[num_counters] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL
+                             | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                             | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB
+                             | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                             | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND},
+    };
+    for (size_t i = 0; i < num_counters; ++i) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[i].first;
+        attr.config = events[i].second;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // pid = 0, cpu = -1: the calling thread on any CPU
+        fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+}
+
+inline PerfCounters::~PerfCounters() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+inline void PerfCounters::start() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+inline void PerfCounters::stop() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+}
+
+inline CounterValues PerfCounters::read() const {
+    CounterValues values;
+    for (size_t i = 0; i < num_counters; ++i) {
+        uint64_t buf[3]; // value, time enabled, time running
+        if (fds[i] < 0 || ::read(fds[i], buf, sizeof(buf)) != sizeof(buf)) {
+            values.value[i] = -1;
+        } else if (buf[2] == 0) {
+            values.value[i] = 0;
+        } else {
+            values.value[i] = static_cast<int64_t>(static_cast<double>(buf[0]) * buf[1] / buf[2]);
+        }
+    }
+    return values;
+}
+#else
+inline PerfCounters::PerfCounters() { fds.fill(-1); }
+inline PerfCounters::~PerfCounters() = default;
+inline void PerfCounters::start() {}
+inline void PerfCounters::stop() {}
+inline CounterValues PerfCounters::read() const {
+    CounterValues values;
+    values.value.fill(-1);
+    return values;
+}
+#endif
+
+/**
+ * Traversal observer that snapshots the counters at the end of every iteration, giving the
+ * per-iteration deltas next to the kernel's own IterStats. The counters must be running.
+ */
+class PerfIterationLog {
+private:
+    PerfCounters const &counters;
+    CounterValues last;
+public:
+    std::vector<std::pair<IterStats, CounterValues>> records;
+
+    explicit PerfIterationLog(PerfCounters const &counters) : counters{counters}, last{counters.read()} {}
+    /**
+     * Restart the delta, e.g. before a new traversal so set-up work is not attributed to it.
+     */
+    void mark() { last = counters.read(); }
+    void operator()(IterStats const &stats) {
+        CounterValues now = counters.read();
+        records.emplace_back(stats, now - last);
+        last = now;
+    }
+};
+
+/**
+ * Sum per-iteration records of several traversals (threads, sources) by iteration number.
+ */
+inline void merge_iteration_records(std::vector<std::pair<IterStats, CounterValues>> &into,
+                                    std::vector<std::pair<IterStats, CounterValues>> const &records) {
+    for (auto const &[stats, values] : records) {
+        while (static_cast<int>(into.size()) <= stats.iter) {
+            into.emplace_back(IterStats{static_cast<int>(into.size()), stats.direction}, CounterValues{});
+        }
+        auto &[acc_stats, acc_values] = into[stats.iter];
+        acc_stats.frontier_vertices += stats.frontier_vertices;
+        acc_stats.frontier_edges += stats.frontier_edges;
+        acc_stats.active_vertices += stats.active_vertices;
+        acc_stats.edges_scanned += stats.edges_scanned;
+        acc_stats.discovered += stats.discovered;
+        acc_stats.cachelines += stats.cachelines;
+        acc_values += values;
+    }
+}
+
+#endif //EXPERIMENT_COUNTERS_H
@@ -0,0 +1,369 @@
+#ifndef EXPERIMENT_DISTRIBUTED_BFS_H
+#define EXPERIMENT_DISTRIBUTED_BFS_H
+
+#include "graph.h"
+#include "bfs.h"
+#include "bitmap.h"
+#include "atomics.h"
+#include "edge_stream.h"
+#include <mpi.h>
+#include <vector>
+#include <span>
+#include <string>
+#include <memory>
+#include <random>
+#include <numeric>
+#include <utility>
+#include <cstdint>
+#include <algorithm>
+#include <omp.h>
+
+/**
+ * 1D vertex partition for ranks ranks: rank r owns [bounds[r], bounds[r + 1]), with roughly
+ * equal in-edges per rank, given the in-CSR offsets. Inner bounds are multiples of 64 so that
+ * a rank's share of a frontier bitmap is made of whole words.
+ */
+template<typename T, typename OffsetT>
+std::vector<T> partition_1d(OffsetT const *offset, int64_t vertex_number, int ranks) {
+    std::vector<T> bounds(ranks + 1, static_cast<T>(vertex_number));
+    bounds[0] = 0;
+    auto const total = offset[vertex_number] - offset[0];
+    for (int r = 1; r < ranks; ++r) {
+        int64_t bound = std::lower_bound(offset, offset + vertex_number, offset[0] + total * r / ranks) - offset;
+        bounds[r] = static_cast<T>(std::max<int64_t>(bound / 64 * 64, bounds[r - 1]));
+    }
+    return bounds;
+}
+
+template<typename T, typename DstT>
+std::vector<T> partition_1d(Graph<T, DstT> const &graph, int ranks) {
+    return partition_1d<T>(graph.get_in_offset(), graph.get_vertex_number(), ranks);
+}
+
+/**
+ * The in-edges of one rank's vertex range, with global neighbor ids.
+ */
+template<typename T, typename DstT = T>
+class LocalGraph {
+public:
+    typedef typename Graph<T, DstT>::offset_t offset_t;
+private:
+    int64_t vertex_number;
+    T first;
+    T last;
+    std::vector<offset_t> offset;
+    std::vector<DstT> neigh;
+public:
+    LocalGraph(Graph<T, DstT> const &graph, T first, T last)
+        : vertex_number{graph.get_vertex_number()}, first{first}, last{last}, offset(last - first + 1) {
+        auto const *in_offset = graph.get_in_offset();
+        for (T v = first; v <= last; ++v) {
+            offset[v - first] = in_offset[v] - in_offset[first];
+        }
+        for (T v = first; v < last; ++v) {
+            neigh.insert(neigh.end(), graph.in_neighbors(v).begin(), graph.in_neighbors(v).end());
+        }
+    }
+    /**
+     * From the edges (u, v) of the graph with v in [first, last), in any order.
+     */
+    LocalGraph(int64_t vertex_number, T first, T last, std::vector<std::pair<T, DstT>> const &edges)
+        : vertex_number{vertex_number}, first{first}, last{last}, offset(last - first + 1, 0), neigh(edges.size()) {
+#pragma omp parallel for default(shared)
+        for (size_t i = 0; i < edges.size(); ++i) {
+            fetch_and_add(offset[get_dst_id(edges[i].second) - first + 1], 1);
+        }
+        std::partial_sum(offset.begin(), offset.end(), offset.begin());
+        std::vector<offset_t> pos(offset.begin(), offset.end() - 1);
+#pragma omp parallel for default(shared)
+        for (size_t i = 0; i < edges.size(); ++i) {
+            DstT w = edges[i].second;
+            get_dst_id(w) = edges[i].first;
+            neigh[fetch_and_add(pos[get_dst_id(edges[i].second) - first], 1)] = w;
+        }
+#pragma omp parallel for default(shared) schedule(dynamic, 1024)
+        for (T v = first; v < last; ++v) {
+            std::sort(neigh.begin() + offset[v - first], neigh.begin() + offset[v - first + 1],
+                      [](DstT const &lhs, DstT const &rhs) { return get_dst_id(lhs) < get_dst_id(rhs); });
+        }
+    }
+    [[nodiscard]] int64_t get_vertex_number() const { return vertex_number; }
+    [[nodiscard]] T begin() const { return first; }
+    [[nodiscard]] T end() const { return last; }
+    [[nodiscard]] std::span<DstT const> in_neighbors(T v) const {
+        return {neigh.data() + offset[v - first], neigh.data() + offset[v - first + 1]};
+    }
+};
+
+/**
+ * This rank's share of the edges of a graph file. Text files are cut into byte ranges at line
+ * boundaries and .bel files into record ranges, so every rank reads only its part. Compressed
+ * streams cannot be entered in the middle: there every rank decodes the whole file but keeps
+ * only the edges whose source is congruent to it modulo ranks. vertex_number is the count stored
+ * in .bel files, -1 for text.
+ */
+template<typename T, typename DstT = T>
+std::vector<std::pair<T, DstT>> read_edge_share(std::string const &path, int rank, int ranks, int64_t &vertex_number) {
+    typedef std::pair<T, DstT> Edge;
+    vertex_number = -1;
+    if (has_extension(path, ".bel")) {
+        return read_binary_edges<Edge>(path, vertex_number, rank, ranks);
+    }
+    bool const whole = has_extension(path, ".gz") || has_extension(path, ".zst");
+    int workers = parser_threads();
+    std::vector<std::vector<Edge>> parts(workers);
+    auto parse = [&](int thread, char const *begin, char const *end) {
+        parse_edge_lines<T>(begin, end, [&](T u, T v) {
+            if (!whole || u % ranks == rank) {
+                parts[thread].emplace_back(u, DstT{v});
+            }
+        });
+    };
+    if (whole) {
+        parse_edge_file(path, workers, parse);
+    } else {
+        auto [begin, end] = text_file_part(path, rank, ranks);
+        auto file = std::make_shared<FileSource>(path, begin, end);
+        parse_blocks([file](char *buf, size_t n) { return file->read(buf, n); }, workers, parse);
+    }
+    std::vector<Edge> edges;
+    for (auto &part : parts) {
+        edges.insert(edges.end(), part.begin(), part.end());
+        std::vector<Edge>{}.swap(part);
+    }
+    return edges;
+}
+
+/**
+ * Distributed construction over MPI_COMM_WORLD: every rank reads its share of the file
+ * (read_edge_share), the in-degrees summed over the ranks give the partition (partition_1d,
+ * returned in bounds), and every edge is sent to the rank owning its destination. No rank
+ * holds more than its share of the edges plus per-vertex counts.
+ */
+template<typename T, typename DstT = T>
+LocalGraph<T, DstT> load_local_graph(std::string const &path, std::vector<T> &bounds) {
+    typedef std::pair<T, DstT> Edge;
+    typedef typename LocalGraph<T, DstT>::offset_t offset_t;
+    static_assert(sizeof(offset_t) == sizeof(uint64_t));
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+    int64_t file_vertex_number;
+    std::vector<Edge> edges = read_edge_share<T, DstT>(path, rank, ranks, file_vertex_number);
+
+    int64_t max_idx = file_vertex_number - 1;
+#pragma omp parallel for default(shared) reduction(max : max_idx)
+    for (size_t i = 0; i < edges.size(); ++i) {
+        max_idx = std::max<int64_t>({max_idx, edges[i].first, get_dst_id(edges[i].second)});
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &max_idx, 1, MPI_INT64_T, MPI_MAX, MPI_COMM_WORLD);
+    int64_t const vertex_number = max_idx + 1;
+    {
+        std::vector<offset_t> in_offset(vertex_number + 1, 0);
+#pragma omp parallel for default(shared)
+        for (size_t i = 0; i < edges.size(); ++i) {
+            fetch_and_add(in_offset[get_dst_id(edges[i].second) + 1], 1);
+        }
+        MPI_Allreduce(MPI_IN_PLACE, in_offset.data(), static_cast<int>(vertex_number + 1), MPI_UINT64_T, MPI_SUM,
+                      MPI_COMM_WORLD);
+        std::partial_sum(in_offset.begin(), in_offset.end(), in_offset.begin());
+        bounds = partition_1d<T>(in_offset.data(), vertex_number, ranks);
+    }
+
+    auto owner = [&bounds](T v) {
+        return static_cast<int>(std::upper_bound(bounds.begin() + 1, bounds.end(), v) - (bounds.begin() + 1));
+    };
+    std::vector<int> send_counts(ranks, 0), send_displs(ranks, 0);
+    std::vector<int> recv_counts(ranks, 0), recv_displs(ranks, 0);
+    for (auto const &edge : edges) {
+        send_counts[owner(get_dst_id(edge.second))]++;
+    }
+    std::exclusive_scan(send_counts.begin(), send_counts.end(), send_displs.begin(), 0);
+    std::vector<Edge> outgoing(edges.size());
+    {
+        std::vector<int> pos(send_displs);
+        for (auto const &edge : edges) {
+            outgoing[pos[owner(get_dst_id(edge.second))]++] = edge;
+        }
+        std::vector<Edge>{}.swap(edges);
+    }
+    MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    std::exclusive_scan(recv_counts.begin(), recv_counts.end(), recv_displs.begin(), 0);
+    std::vector<Edge> incoming(recv_displs[ranks - 1] + static_cast<size_t>(recv_counts[ranks - 1]));
+    MPI_Datatype edge_type;
+    MPI_Type_contiguous(sizeof(Edge), MPI_BYTE, &edge_type);
+    MPI_Type_commit(&edge_type);
+    MPI_Alltoallv(outgoing.data(), send_counts.data(), send_displs.data(), edge_type,
+                  incoming.data(), recv_counts.data(), recv_displs.data(), edge_type, MPI_COMM_WORLD);
+    MPI_Type_free(&edge_type);
+    std::vector<Edge>{}.swap(outgoing);
+    return {vertex_number, bounds[rank], bounds[rank + 1], incoming};
+}
+
+/**
+ * n random sources with at least one out-edge, the same on every rank. Each rank marks the
+ * tails of its in-edges, rank 0 draws from the union and broadcasts the draw.
+ */
+template<typename T, typename DstT>
+std::vector<T> pick_distributed_sources(LocalGraph<T, DstT> const &local, int n) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    Bitmap has_out(local.get_vertex_number());
+    has_out.reset();
+#pragma omp parallel for default(shared) schedule(dynamic, 1024)
+    for (T v = local.begin(); v < local.end(); ++v) {
+        for (auto const &u : local.in_neighbors(v)) {
+            has_out.set_bit_atomic(get_dst_id(u));
+        }
+    }
+    MPI_Reduce(rank == 0 ? MPI_IN_PLACE : has_out.data(), has_out.data(), static_cast<int>(has_out.num_words()),
+               MPI_UINT64_T, MPI_BOR, 0, MPI_COMM_WORLD);
+    std::vector<T> sources(n);
+    if (rank == 0) {
+        std::random_device rd;
+        std::mt19937 rng(rd());
+        std::uniform_int_distribution<T> dist(0, static_cast<T>(local.get_vertex_number() - 1));
+        for (auto &source : sources) {
+            do {
+                source = dist(rng);
+            } while (!has_out.get_bit(source));
+        }
+    }
+    MPI_Bcast(sources.data(), static_cast<int>(n * sizeof(T)), MPI_BYTE, 0, MPI_COMM_WORLD);
+    return sources;
+}
+
+/**
+ * Communication of one rank over a traversal. Bytes count the frontier payload this rank
+ * contributes to, and takes from, the allgathers.
+ */
+struct CommStats {
+    long long bytes_sent{};
+    long long bytes_received{};
+    double seconds{};
+    long long sparse_messages{};
+    long long bitmap_messages{};
+};
+
+constexpr uint64_t frontier_bitmap_flag = uint64_t{1} << 63;
+
+/**
+ * Encode the newly discovered vertices of [first, last) (as offsets from first) into msg:
+ * a header word with the count, plus either the offsets packed two per word or the bitmap of
+ * the range, whichever is shorter. The bitmap flag in the header tells them apart.
+ */
+inline void encode_frontier(std::vector<uint32_t> const &discovered, int64_t range, std::vector<uint64_t> &msg) {
+    size_t const sparse_words = (discovered.size() + 1) / 2;
+    size_t const bitmap_words = (range + 63) / 64;
+    msg.clear();
+    if (sparse_words < bitmap_words) {
+        msg.resize(1 + sparse_words, 0);
+        msg[0] = discovered.size();
+        for (size_t i = 0; i < discovered.size(); ++i) {
+            msg[1 + i / 2] |= static_cast<uint64_t>(discovered[i]) << (32 * (i & 1));
+        }
+    } else {
+        msg.resize(1 + bitmap_words, 0);
+        msg[0] = discovered.size() | frontier_bitmap_flag;
+        for (uint32_t v : discovered) {
+            msg[1 + v / 64] |= uint64_t{1} << (v & 63);
+        }
+    }
+}
+
+/**
+ * Level-synchronous bottom-up BFS over MPI_COMM_WORLD. Every rank checks its unvisited vertices
+ * against the global frontier bitmap, then the ranks allgather their discoveries, each encoded
+ * as a sparse list or a bitmap depending on its density, and rebuild the global frontier.
+ * Returns the depths of the rank's own vertices.
+ */
+template<typename T, typename DstT, typename PropT = int, typename Observer = NullIterObserver>
+std::vector<PropT> do_distributed_bfs(LocalGraph<T, DstT> const &local, std::vector<T> const &bounds, T root,
+                                      CommStats &comm, Observer &&observer = {}) {
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+    T const first = local.begin();
+    T const last = local.end();
+    std::vector<PropT> depth(last - first, get_max_prop<PropT>());
+    if (root >= first && root < last) {
+        depth[root - first] = 0;
+    }
+    Bitmap front(local.get_vertex_number());
+    front.reset();
+    front.set_bit(root);
+
+    std::vector<uint32_t> discovered;
+    std::vector<uint64_t> msg;
+    std::vector<uint64_t> all_msg;
+    std::vector<int> counts(ranks);
+    std::vector<int> displs(ranks);
+    long long sum = 1;
+    for (PropT iter = 0; sum > 0; ++iter) {
+        IterStats stats{iter, Direction::pull, sum};
+        discovered.clear();
+        long long edges_scanned{};
+#pragma omp parallel default(shared) reduction(+ : edges_scanned)
+        {
+            std::vector<uint32_t> local_discovered;
+#pragma omp for schedule(dynamic, 1024) nowait
+            for (T v = first; v < last; ++v) {
+                if (!is_max_prop(depth[v - first])) {
+                    continue;
+                }
+                for (auto const &u : local.in_neighbors(v)) {
+                    edges_scanned++;
+                    if (front.get_bit(get_dst_id(u))) {
+                        depth[v - first] = iter + 1;
+                        local_discovered.emplace_back(v - first);
+                        break;
+                    }
+                }
+            }
+#pragma omp critical
+            discovered.insert(discovered.end(), local_discovered.begin(), local_discovered.end());
+        }
+
+        encode_frontier(discovered, last - first, msg);
+        double start = MPI_Wtime();
+        int own = static_cast<int>(msg.size());
+        MPI_Allgather(&own, 1, MPI_INT, counts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+        int total{};
+        for (int r = 0; r < ranks; ++r) {
+            displs[r] = total;
+            total += counts[r];
+        }
+        all_msg.resize(total);
+        MPI_Allgatherv(msg.data(), own, MPI_UINT64_T, all_msg.data(), counts.data(), displs.data(),
+                       MPI_UINT64_T, MPI_COMM_WORLD);
+        comm.seconds += MPI_Wtime() - start;
+        comm.bytes_sent += static_cast<long long>(own) * sizeof(uint64_t) * (ranks - 1);
+        comm.bytes_received += static_cast<long long>(total - own) * sizeof(uint64_t);
+        if (msg[0] & frontier_bitmap_flag) {
+            comm.bitmap_messages++;
+        } else {
+            comm.sparse_messages++;
+        }
+
+        front.reset();
+        sum = 0;
+        for (int r = 0; r < ranks; ++r) {
+            uint64_t const *payload = all_msg.data() + displs[r] + 1;
+            uint64_t const header = payload[-1];
+            uint64_t const k = header & ~frontier_bitmap_flag;
+            sum += static_cast<long long>(k);
+            if (header & frontier_bitmap_flag) {
+                std::copy(payload, payload + counts[r] - 1, front.data() + bounds[r] / 64);
+            } else {
+                for (uint64_t i = 0; i < k; ++i) {
+                    front.set_bit(bounds[r] + static_cast<uint32_t>(payload[i / 2] >> (32 * (i & 1))));
+                }
+            }
+        }
+        stats.edges_scanned = edges_scanned;
+        stats.discovered = sum;
+        observer(stats);
+    }
+    return depth;
+}
+
+#endif //EXPERIMENT_DISTRIBUTED_BFS_H
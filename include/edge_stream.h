@@ -0,0 +1,650 @@
+#ifndef EXPERIMENT_EDGE_STREAM_H
+#define EXPERIMENT_EDGE_STREAM_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <charconv>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <exception>
+#include <iterator>
+#include <type_traits>
+#include <limits>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <omp.h>
+#if defined(HAVE_ZLIB)
+#include <zlib.h>
+#endif
+#if defined(HAVE_ZSTD)
+#include <zstd.h>
+#endif
+
+constexpr size_t edge_block_size = 16 << 20;
+
+/**
+ * Exceptions cannot leave an OpenMP region or a thread, so the iterations of a parallel loop
+ * run through run(), which keeps the first exception, and rethrow() raises it after the loop.
+ */
+class ParallelError {
+private:
+    std::mutex mutex;
+    std::exception_ptr error;
+public:
+    template<typename F>
+    void run(F &&f) noexcept {
+        try {
+            f();
+        } catch (...) {
+            std::lock_guard lock{mutex};
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+    void rethrow() {
+        if (error) {
+            std::rethrow_exception(std::exchange(error, nullptr));
+        }
+    }
+};
+
+/**
+ * Parse the edge lines in [p, end), calling emit(u, v) for each. Lines starting with '#'
+ * and lines without two ids are skipped, anything after the second id is ignored.
+ */
+template<typename T, typename Emit>
+void parse_edge_lines(char const *p, char const *end, Emit &&emit) {
+    auto skip_blanks = [end](char const *q) {
+        while (q < end && (*q == ' ' || *q == '\t')) {
+            ++q;
+        }
+        return q;
+    };
+    while (p < end) {
+        char const *eol = static_cast<char const *>(std::memchr(p, '\n', end - p));
+        if (eol == nullptr) {
+            eol = end;
+        }
+        p = skip_blanks(p);
+        if (p < eol && *p != '#') {
+            T u, v;
+            auto [q, ec] = std::from_chars(p, eol, u);
+            if (ec == std::errc{}) {
+                auto [r, ec2] = std::from_chars(skip_blanks(q), eol, v);
+                if (ec2 == std::errc{}) {
+                    emit(u, v);
+                }
+            }
+        }
+        p = eol + 1;
+    }
+}
+
+/**
+ * Sequential reads of a file, or of the byte range [begin, end) of it, through pread.
+ */
+class FileSource {
+private:
+    int fd;
+    off_t offset;
+    off_t end;
+public:
+    explicit FileSource(std::string const &path, off_t begin = 0, off_t end = std::numeric_limits<off_t>::max())
+        : fd{::open(path.c_str(), O_RDONLY)}, offset{begin}, end{end} {
+        assert(fd >= 0);
+#if defined(POSIX_FADV_SEQUENTIAL)
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+    ~FileSource() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    FileSource(FileSource &&other) noexcept
+        : fd{std::exchange(other.fd, -1)}, offset{other.offset}, end{other.end} {}
+    FileSource(FileSource const &) = delete;
+    /**
+     * Fill up to n bytes, returns fewer only at the end of the file or range.
+     */
+    size_t read(char *buf, size_t n) {
+        n = static_cast<size_t>(std::min<off_t>(static_cast<off_t>(n), std::max<off_t>(end - offset, 0)));
+        size_t done{};
+        while (done < n) {
+            ssize_t got = ::pread(fd, buf + done, n - done, offset);
+            if (got <= 0) {
+                break;
+            }
+            done += got;
+            offset += got;
+        }
+        return done;
+    }
+};
+
+/**
+ * Byte range of part of parts of a text file cut into nearly equal pieces: the lines that start
+ * in [size * part / parts, size * (part + 1) / parts), so every line falls into exactly one part.
+ */
+inline std::pair<off_t, off_t> text_file_part(std::string const &path, int part, int parts) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st{};
+    if (fd < 0 || ::fstat(fd, &st) != 0) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        throw std::runtime_error("cannot open " + path);
+    }
+    off_t const size = st.st_size;
+    // the first line that starts at or after pos
+    auto line_start = [fd, size](off_t pos) {
+        if (pos == 0) {
+            return off_t{0};
+        }
+        char buf[4096];
+        for (off_t at = pos - 1; at < size; at += sizeof(buf)) {
+            ssize_t got = ::pread(fd, buf, sizeof(buf), at);
+            if (got <= 0) {
+                break;
+            }
+            if (auto const *eol = static_cast<char const *>(std::memchr(buf, '\n', got))) {
+                return at + (eol - buf) + 1;
+            }
+        }
+        return size;
+    };
+    off_t begin = line_start(size * part / parts);
+    off_t end = line_start(size * (part + 1) / parts);
+    ::close(fd);
+    return {begin, std::max(begin, end)};
+}
+
+/**
+ * Reads a byte stream on a background thread into a fixed pool of buffers, each handed out
+ * cut at its last newline (the partial line moves to the next block), so blocks can be parsed
+ * independently and in any order while the next ones are being read.
+ */
+class BlockReader {
+public:
+    struct Block {
+        std::vector<char> data;
+        size_t size{};
+    };
+    typedef std::function<size_t(char *, size_t)> ReadFn;
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<Block> blocks;
+    std::deque<Block *> free_blocks;
+    std::deque<Block *> full_blocks;
+    bool finished;
+    // what the read function threw on the reader thread, for the consumer to rethrow
+    std::exception_ptr error;
+    std::thread reader;
+
+    void run(ReadFn read, size_t block_size);
+public:
+    BlockReader(ReadFn read, size_t block_size = edge_block_size, size_t num_blocks = 4)
+        : blocks(num_blocks), finished{false} {
+        for (auto &block : blocks) {
+            free_blocks.push_back(&block);
+        }
+        reader = std::thread{&BlockReader::run, this, std::move(read), block_size};
+    }
+    ~BlockReader() { reader.join(); }
+    /**
+     * The next block to parse, or nullptr when the stream is exhausted.
+     */
+    Block *acquire() {
+        std::unique_lock lock{mutex};
+        cv.wait(lock, [this] { return !full_blocks.empty() || finished; });
+        if (full_blocks.empty()) {
+            return nullptr;
+        }
+        Block *block = full_blocks.front();
+        full_blocks.pop_front();
+        return block;
+    }
+    void release(Block *block) {
+        {
+            std::lock_guard lock{mutex};
+            free_blocks.push_back(block);
+        }
+        cv.notify_all();
+    }
+    /**
+     * After acquire returned nullptr: rethrow the exception that ended the stream early, if any.
+     */
+    void rethrow_error() {
+        std::lock_guard lock{mutex};
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+inline void BlockReader::run(ReadFn read, size_t block_size) {
+    std::vector<char> carry;
+    while (true) {
+        Block *block;
+        {
+            std::unique_lock lock{mutex};
+            cv.wait(lock, [this] { return !free_blocks.empty(); });
+            block = free_blocks.front();
+            free_blocks.pop_front();
+        }
+        block->data.resize(carry.size() + block_size);
+        std::copy(carry.begin(), carry.end(), block->data.begin());
+        size_t got;
+        try {
+            got = read(block->data.data() + carry.size(), block_size);
+        } catch (...) {
+            // an exception escaping this thread would terminate; end the stream instead
+            {
+                std::lock_guard lock{mutex};
+                error = std::current_exception();
+                free_blocks.push_back(block);
+                finished = true;
+            }
+            cv.notify_all();
+            break;
+        }
+        size_t size = carry.size() + got;
+        size_t cut = size;
+        if (got > 0) {
+            auto last = std::find(block->data.rbegin() + (block->data.size() - size), block->data.rend(), '\n');
+            cut = block->data.rend() - last;
+        }
+        carry.assign(block->data.begin() + cut, block->data.begin() + size);
+        block->size = cut;
+        {
+            std::lock_guard lock{mutex};
+            if (cut > 0) {
+                full_blocks.push_back(block);
+            } else {
+                free_blocks.push_back(block);
+            }
+            finished = (got == 0);
+        }
+        cv.notify_all();
+        if (got == 0) {
+            break;
+        }
+    }
+}
+
+#if defined(HAVE_ZLIB)
+/**
+ * Decompressed reads of a gzip file (concatenated members included). gzip cannot be split, so
+ * decoding stays on the reader thread and overlaps with parsing only.
+ */
+class GzipSource {
+private:
+    gzFile file;
+public:
+    explicit GzipSource(std::string const &path) : file{gzopen(path.c_str(), "rb")} {
+        assert(file != nullptr);
+        gzbuffer(file, 1 << 20);
+    }
+    ~GzipSource() { gzclose(file); }
+    GzipSource(GzipSource const &) = delete;
+    size_t read(char *buf, size_t n) {
+        size_t done{};
+        while (done < n) {
+            int got = gzread(file, buf + done, static_cast<unsigned>(std::min<size_t>(n - done, 1u << 30)));
+            if (got < 0) {
+                int err;
+                throw std::runtime_error(gzerror(file, &err));
+            }
+            if (got == 0) {
+                break;
+            }
+            done += got;
+        }
+        return done;
+    }
+};
+#endif
+
+#if defined(HAVE_ZSTD)
+/**
+ * Streaming decompression of a zstd file, for files that hold a single frame.
+ */
+class ZstdSource {
+private:
+    FileSource file;
+    ZSTD_DStream *stream;
+    std::vector<char> in;
+    ZSTD_inBuffer in_buf;
+    bool eof;
+public:
+    explicit ZstdSource(std::string const &path)
+        : file{path}, stream{ZSTD_createDStream()}, in(ZSTD_DStreamInSize()), in_buf{in.data(), 0, 0}, eof{false} {
+        ZSTD_initDStream(stream);
+    }
+    ~ZstdSource() { ZSTD_freeDStream(stream); }
+    ZstdSource(ZstdSource const &) = delete;
+    size_t read(char *buf, size_t n) {
+        ZSTD_outBuffer out{buf, n, 0};
+        while (out.pos < out.size) {
+            if (in_buf.pos == in_buf.size && !eof) {
+                in_buf = {in.data(), file.read(in.data(), in.size()), 0};
+                eof = in_buf.size == 0;
+            }
+            size_t before = out.pos;
+            size_t ret = ZSTD_decompressStream(stream, &out, &in_buf);
+            if (ZSTD_isError(ret)) {
+                throw std::runtime_error(ZSTD_getErrorName(ret));
+            }
+            // past the end of the file the decoder may still hold output; flush until it is done
+            if (eof && (ret == 0 || out.pos == before)) {
+                break;
+            }
+        }
+        return out.pos;
+    }
+};
+
+/**
+ * Byte ranges of the zstd frames in [data, data + size), skippable frames (e.g. the seek
+ * table of the seekable format) left out.
+ */
+inline std::vector<std::pair<size_t, size_t>> zstd_frames(char const *data, size_t size) {
+    std::vector<std::pair<size_t, size_t>> frames;
+    for (size_t pos = 0; pos < size;) {
+        size_t frame_size = ZSTD_findFrameCompressedSize(data + pos, size - pos);
+        if (ZSTD_isError(frame_size)) {
+            throw std::runtime_error(ZSTD_getErrorName(frame_size));
+        }
+        uint32_t magic;
+        std::memcpy(&magic, data + pos, sizeof(magic));
+        if ((magic & ZSTD_MAGIC_SKIPPABLE_MASK) != ZSTD_MAGIC_SKIPPABLE_START) {
+            frames.emplace_back(pos, frame_size);
+        }
+        pos += frame_size;
+    }
+    return frames;
+}
+
+inline void zstd_decompress_frame(ZSTD_DCtx *ctx, char const *src, size_t size, std::vector<char> &out) {
+    unsigned long long content_size = ZSTD_getFrameContentSize(src, size);
+    if (content_size != ZSTD_CONTENTSIZE_UNKNOWN && content_size != ZSTD_CONTENTSIZE_ERROR) {
+        out.resize(content_size);
+        size_t ret = ZSTD_decompressDCtx(ctx, out.data(), out.size(), src, size);
+        if (ZSTD_isError(ret)) {
+            throw std::runtime_error(ZSTD_getErrorName(ret));
+        }
+        return;
+    }
+    ZSTD_DCtx_reset(ctx, ZSTD_reset_session_only);
+    ZSTD_inBuffer in{src, size, 0};
+    out.resize(std::max<size_t>(size * 4, ZSTD_DStreamOutSize()));
+    ZSTD_outBuffer buf{out.data(), out.size(), 0};
+    while (in.pos < in.size) {
+        if (buf.pos == buf.size) {
+            out.resize(out.size() * 2);
+            buf = {out.data(), out.size(), buf.pos};
+        }
+        size_t ret = ZSTD_decompressStream(ctx, &buf, &in);
+        if (ZSTD_isError(ret)) {
+            throw std::runtime_error(ZSTD_getErrorName(ret));
+        }
+        if (ret == 0) {
+            break;
+        }
+    }
+    out.resize(buf.pos);
+}
+
+/**
+ * parse_blocks for zstd files made of several frames (zstd --long ... | pzstd, or the seekable
+ * format): the frames of a window of one per worker are decoded in parallel, and their lines
+ * parsed in parallel too. A line split across two frames is put back together and parsed
+ * serially, as is the case of a frame without any newline. Returns false when the file holds
+ * a single frame, which cannot be decoded in parallel.
+ */
+template<typename ParseBlock>
+bool parse_zstd_frames(std::string const &path, int workers, ParseBlock &&parse) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    assert(fd >= 0);
+    struct stat st{};
+    fstat(fd, &st);
+    size_t size = st.st_size;
+    void *mapped = (size > 0) ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    ::close(fd);
+    assert(size == 0 || mapped != MAP_FAILED);
+    char const *data = static_cast<char const *>(mapped);
+    std::vector<std::pair<size_t, size_t>> frames;
+    try {
+        frames = zstd_frames(data, size);
+    } catch (...) {
+        munmap(mapped, size);
+        throw;
+    }
+    if (frames.size() < 2) {
+        if (mapped) {
+            munmap(mapped, size);
+        }
+        return false;
+    }
+
+    std::vector<std::vector<char>> decoded(workers);
+    std::vector<ZSTD_DCtx *> contexts(workers);
+    for (auto &ctx : contexts) {
+        ctx = ZSTD_createDCtx();
+    }
+    auto release = [&] {
+        for (auto ctx : contexts) {
+            ZSTD_freeDCtx(ctx);
+        }
+        munmap(mapped, size);
+    };
+    ParallelError error;
+    std::vector<char> pending; // an unfinished line
+    std::vector<std::pair<size_t, size_t>> body(workers); // the whole lines of each frame
+    try {
+        for (size_t first = 0; first < frames.size(); first += workers) {
+            size_t window = std::min<size_t>(workers, frames.size() - first);
+#pragma omp parallel for num_threads(workers) schedule(dynamic, 1) default(shared)
+            for (size_t i = 0; i < window; ++i) {
+                error.run([&] {
+                    auto [offset, frame_size] = frames[first + i];
+                    zstd_decompress_frame(contexts[omp_get_thread_num()], data + offset, frame_size, decoded[i]);
+                });
+            }
+            error.rethrow();
+            for (size_t i = 0; i < window; ++i) {
+                auto const &buf = decoded[i];
+                auto head = std::find(buf.begin(), buf.end(), '\n');
+                if (head == buf.end()) {
+                    pending.insert(pending.end(), buf.begin(), buf.end());
+                    body[i] = {0, 0};
+                    continue;
+                }
+                pending.insert(pending.end(), buf.begin(), head + 1);
+                parse(0, pending.data(), pending.data() + pending.size());
+                auto tail = std::find(buf.rbegin(), buf.rend(), '\n').base();
+                body[i] = {head + 1 - buf.begin(), tail - buf.begin()};
+                pending.assign(tail, buf.end());
+            }
+#pragma omp parallel for num_threads(workers) schedule(dynamic, 1) default(shared)
+            for (size_t i = 0; i < window; ++i) {
+                error.run([&] {
+                    parse(omp_get_thread_num(), decoded[i].data() + body[i].first, decoded[i].data() + body[i].second);
+                });
+            }
+            error.rethrow();
+        }
+        parse(0, pending.data(), pending.data() + pending.size());
+    } catch (...) {
+        release();
+        throw;
+    }
+    release();
+    return true;
+}
+#endif
+
+/**
+ * Binary edge list (.bel): this header, then count records of record_bytes bytes each,
+ * i.e. the raw std::pair<T, DstT> array of Builder::EdgeList. vertex_number is stored since
+ * isolated vertices past the largest id cannot be told from the edges.
+ */
+struct BinaryEdgeHeader {
+    char magic[8];
+    uint64_t record_bytes;
+    uint64_t count;
+    uint64_t vertex_number;
+};
+
+constexpr char binary_edge_magic[8] = {'E', 'D', 'G', 'E', 'L', 'S', 'T', '2'};
+
+template<typename Edge>
+void write_binary_edges(std::string const &path, std::vector<Edge> const &edges, int64_t vertex_number) {
+    static_assert(std::is_trivially_copy_constructible_v<Edge> && std::is_trivially_destructible_v<Edge>);
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(fd >= 0);
+    BinaryEdgeHeader header{{}, sizeof(Edge), edges.size(), static_cast<uint64_t>(vertex_number)};
+    std::copy(std::begin(binary_edge_magic), std::end(binary_edge_magic), header.magic);
+    auto write_all = [fd](void const *buf, size_t n) {
+        auto const *p = static_cast<char const *>(buf);
+        while (n > 0) {
+            ssize_t done = ::write(fd, p, n);
+            if (done <= 0) {
+                throw std::runtime_error("short write of binary edge list");
+            }
+            p += done;
+            n -= done;
+        }
+    };
+    write_all(&header, sizeof(header));
+    write_all(edges.data(), edges.size() * sizeof(Edge));
+    ::close(fd);
+}
+
+/**
+ * Read a .bel file straight into the edge array, in parallel chunks of edge_block_size, and its
+ * vertex count into vertex_number. With parts > 1 only the records of part, a contiguous share
+ * of about count / parts, are read.
+ */
+template<typename Edge>
+std::vector<Edge> read_binary_edges(std::string const &path, int64_t &vertex_number, int part = 0, int parts = 1) {
+    static_assert(std::is_trivially_copy_constructible_v<Edge> && std::is_trivially_destructible_v<Edge>);
+    int fd = ::open(path.c_str(), O_RDONLY);
+    assert(fd >= 0);
+    BinaryEdgeHeader header{};
+    if (::pread(fd, &header, sizeof(header), 0) != sizeof(header)
+        || !std::equal(std::begin(binary_edge_magic), std::end(binary_edge_magic), header.magic)
+        || header.record_bytes != sizeof(Edge)) {
+        ::close(fd);
+        throw std::runtime_error("not a binary edge list of this version and vertex type: " + path);
+    }
+    vertex_number = static_cast<int64_t>(header.vertex_number);
+    uint64_t const first = header.count * part / parts;
+    std::vector<Edge> edges(header.count * (part + 1) / parts - first);
+    char *dst = reinterpret_cast<char *>(edges.data());
+    size_t const bytes = edges.size() * sizeof(Edge);
+    off_t const base = static_cast<off_t>(sizeof(header) + first * sizeof(Edge));
+    size_t const chunks = (bytes + edge_block_size - 1) / edge_block_size;
+    bool complete = true;
+#pragma omp parallel for default(shared) schedule(dynamic, 1) reduction(&& : complete)
+    for (size_t c = 0; c < chunks; ++c) {
+        size_t begin = c * edge_block_size;
+        size_t end = std::min(bytes, begin + edge_block_size);
+        while (begin < end) {
+            ssize_t got = ::pread(fd, dst + begin, end - begin, base + begin);
+            if (got <= 0) {
+                complete = false;
+                break;
+            }
+            begin += got;
+        }
+    }
+    ::close(fd);
+    if (!complete) {
+        throw std::runtime_error("truncated binary edge list: " + path);
+    }
+    return edges;
+}
+
+inline bool has_extension(std::string const &path, std::string const &ext) {
+    return path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+/**
+ * Decompressed byte stream of an edge file for BlockReader, picked by the file extension.
+ */
+inline BlockReader::ReadFn open_edge_source(std::string const &path) {
+    if (has_extension(path, ".gz")) {
+#if defined(HAVE_ZLIB)
+        auto file = std::make_shared<GzipSource>(path);
+        return [file](char *buf, size_t n) { return file->read(buf, n); };
+#else
+        throw std::runtime_error("built without zlib, cannot read " + path);
+#endif
+    }
+    if (has_extension(path, ".zst")) {
+#if defined(HAVE_ZSTD)
+        auto file = std::make_shared<ZstdSource>(path);
+        return [file](char *buf, size_t n) { return file->read(buf, n); };
+#else
+        throw std::runtime_error("built without zstd, cannot read " + path);
+#endif
+    }
+    auto file = std::make_shared<FileSource>(path);
+    return [file](char *buf, size_t n) { return file->read(buf, n); };
+}
+
+/**
+ * Run parse(thread, begin, end) over the blocks of read on all but one OpenMP thread; the
+ * remaining core is left to the reader.
+ */
+template<typename ParseBlock>
+void parse_blocks(BlockReader::ReadFn read, int workers, ParseBlock &&parse) {
+    BlockReader reader{std::move(read), edge_block_size, static_cast<size_t>(workers) + 2};
+    ParallelError error;
+#pragma omp parallel num_threads(workers) default(shared)
+    {
+        int thread = omp_get_thread_num();
+        // blocks keep being released after a failure, so that the reader can run to its end
+        while (BlockReader::Block *block = reader.acquire()) {
+            error.run([&] { parse(thread, block->data.data(), block->data.data() + block->size); });
+            reader.release(block);
+        }
+    }
+    error.rethrow();
+    reader.rethrow_error();
+}
+
+/**
+ * parse(thread, begin, end) over the lines of an edge file, plain, .gz or .zst. Multi-frame
+ * zstd files are decoded frame-parallel, everything else is streamed through BlockReader.
+ */
+template<typename ParseBlock>
+void parse_edge_file(std::string const &path, int workers, ParseBlock &&parse) {
+#if defined(HAVE_ZSTD)
+    if (has_extension(path, ".zst") && parse_zstd_frames(path, workers, parse)) {
+        return;
+    }
+#endif
+    parse_blocks(open_edge_source(path), workers, parse);
+}
+
+inline int parser_threads() {
+    return std::max(1, omp_get_max_threads() - 1);
+}
+
+#endif //EXPERIMENT_EDGE_STREAM_H
@@ -0,0 +1,79 @@
+#ifndef EXPERIMENT_GENERATOR_H
+#define EXPERIMENT_GENERATOR_H
+
+#include <vector>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+
+/**
+ * R-MAT (Chakrabarti et al., SDM'04) parameters: 2^scale vertices, edge_factor * 2^scale
+ * edges, and the probabilities of the four adjacency matrix quadrants (d = 1 - a - b - c).
+ * The defaults are the Graph500 Kronecker ones.
+ */
+struct RmatParams {
+    int scale = 20;
+    int edge_factor = 16;
+    double a = 0.57;
+    double b = 0.19;
+    double c = 0.19;
+    uint64_t seed = 27491095;
+};
+
+constexpr size_t rmat_block_edges = 1 << 16;
+
+/**
+ * Seed of the generator of block i, a splitmix64 step so that neighboring blocks get
+ * unrelated streams.
+ */
+inline uint64_t rmat_block_seed(uint64_t seed, uint64_t i) {
+    uint64_t z = seed + (i + 1) * 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Parallel R-MAT edge list. Edges come in fixed blocks with their own seeded generator, so the
+ * output only depends on the parameters, not on the number of threads or the schedule.
+ * Vertex ids are scrambled by a seeded permutation, as in Graph500, so that the degree does not
+ * follow the id. Self loops and duplicate edges are kept.
+ */
+template<typename T, typename DstT = T>
+std::vector<std::pair<T, DstT>> generate_rmat(RmatParams const &params) {
+    int64_t const vertex_number = int64_t{1} << params.scale;
+    size_t const edge_number = static_cast<size_t>(params.edge_factor) * vertex_number;
+    std::vector<std::pair<T, DstT>> el(edge_number);
+
+    std::vector<T> permutation(vertex_number);
+    std::iota(permutation.begin(), permutation.end(), 0);
+    std::shuffle(permutation.begin(), permutation.end(), std::mt19937_64{params.seed});
+
+    // quadrant thresholds on 32-bit draws, two draws per 64-bit random word
+    auto threshold = [](double p) { return static_cast<uint64_t>(p * 4294967296.0); };
+    uint64_t const a = threshold(params.a);
+    uint64_t const ab = threshold(params.a + params.b);
+    uint64_t const abc = threshold(params.a + params.b + params.c);
+    size_t const blocks = (edge_number + rmat_block_edges - 1) / rmat_block_edges;
+#pragma omp parallel for default(shared) schedule(dynamic, 4)
+    for (size_t block = 0; block < blocks; ++block) {
+        std::mt19937_64 rng{rmat_block_seed(params.seed, block)};
+        size_t const end = std::min(edge_number, (block + 1) * rmat_block_edges);
+        for (size_t i = block * rmat_block_edges; i < end; ++i) {
+            int64_t u{}, v{};
+            uint64_t bits{};
+            for (int level = 0; level < params.scale; ++level) {
+                bits = (level & 1) ? bits >> 32 : rng();
+                uint64_t r = bits & 0xffffffffu;
+                u = (u << 1) | (r >= ab);
+                v = (v << 1) | ((r >= a && r < ab) || r >= abc);
+            }
+            el[i] = {permutation[u], DstT{permutation[v]}};
+        }
+    }
+    return el;
+}
+
+#endif //EXPERIMENT_GENERATOR_H
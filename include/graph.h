@@ -10,6 +10,13 @@
 #include <functional>
 #include <queue>
 #include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <iterator>
+#include <string>
+#include <stdexcept>
+#include "atomics.h"
 
 template<typename T,
     typename=std::enable_if_t<std::is_integral_v<T>>>
@@ -23,12 +30,26 @@ public:
     typedef std::make_unsigned<std::ptrdiff_t>::type offset_t;
 private:
     bool directed;
+    // symmetric graph stored as its edges u < v only, see full_neighbors
+    bool upper_triangular{false};
     int64_t vertex_number;
     int64_t edge_number;
     offset_t *out_offset;
     DstT *out_neigh;
-    offset_t *in_offset;
-    DstT *in_neigh;
+    // directed graphs may get their in-CSR (transpose) only on first use, see build_transpose
+    mutable offset_t *in_offset;
+    mutable DstT *in_neigh;
+    struct TransposeState {
+        std::once_flag once;
+        std::atomic<bool> ready{false};
+    };
+    std::unique_ptr<TransposeState> transpose_state;
+
+    void ensure_transpose() const {
+        if (directed && !transpose_state->ready.load(std::memory_order_acquire)) {
+            build_transpose();
+        }
+    }
 
     struct Neighborhood {
         T n;
@@ -39,10 +60,62 @@ private:
         iterator begin() { return neigh + offset[n]; }
         iterator end() { return neigh + offset[n + 1]; }
     };
+
+    /**
+     * Two sorted neighbor ranges walked one after the other.
+     */
+    struct FullNeighborhood {
+        DstT const *first_begin;
+        DstT const *first_end;
+        DstT const *second_begin;
+        DstT const *second_end;
+
+        struct iterator {
+            typedef std::forward_iterator_tag iterator_category;
+            typedef DstT value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef DstT const *pointer;
+            typedef DstT const &reference;
+
+            DstT const *pos;
+            DstT const *first_end;
+            DstT const *second_begin;
+
+            DstT const &operator*() const { return *pos; }
+            iterator &operator++() {
+                if (++pos == first_end) {
+                    pos = second_begin;
+                }
+                return *this;
+            }
+            iterator operator++(int) {
+                iterator old = *this;
+                ++*this;
+                return old;
+            }
+            bool operator==(iterator const &other) const { return pos == other.pos; }
+            bool operator!=(iterator const &other) const { return pos != other.pos; }
+        };
+        iterator begin() const {
+            return {first_begin == first_end ? second_begin : first_begin, first_end, second_begin};
+        }
+        iterator end() const { return {second_end, first_end, second_begin}; }
+    };
 public:
     Graph(): directed{false}, vertex_number{0}, edge_number{0}, out_offset{nullptr},
         out_neigh{nullptr}, in_offset{nullptr}, in_neigh{nullptr} {};
     Graph(int64_t vertex_number, offset_t *&out_offset, DstT *&out_neigh);
+    /**
+     * Directed graph from its out-CSR only; the in-CSR is built when first needed.
+     */
+    Graph(int64_t vertex_number, offset_t *&out_offset, DstT *&out_neigh, bool directed);
+    /**
+     * Symmetric graph of which out_offset/out_neigh only hold the edges (u, v) with u < v.
+     * It is kept as a directed graph: the lazily built in-CSR is the lower half, so
+     * out_neighbors/in_neighbors are the neighbors above/below a vertex and full_neighbors
+     * all of them. Kernels that take such a graph check is_upper_triangular.
+     */
+    static Graph<T, DstT> upper_triangular_graph(int64_t vertex_number, offset_t *&out_offset, DstT *&out_neigh);
     Graph(int64_t vertex_number, offset_t *&out_offset, DstT *&out_neigh,
           offset_t *&in_offset, DstT *&in_neigh);
     Graph(Graph<T, DstT> const &graph) = delete;
@@ -55,18 +128,65 @@ public:
     [[nodiscard]] int64_t get_vertex_number() const { return vertex_number; }
     [[nodiscard]] int64_t get_edge_number() const { return edge_number; }
     [[nodiscard]] bool is_directed() const { return directed; }
+    [[nodiscard]] bool is_upper_triangular() const { return upper_triangular; }
     [[nodiscard]] offset_t const *get_offset() const { return out_offset; }
+    [[nodiscard]] offset_t const *get_in_offset() const { ensure_transpose(); return in_offset; }
     offset_t out_degree(T n) const { return out_offset[n + 1] - out_offset[n]; }
-    offset_t in_degree(T n) const { return in_offset[n + 1] - in_offset[n]; }
+    offset_t in_degree(T n) const { ensure_transpose(); return in_offset[n + 1] - in_offset[n]; }
     Neighborhood out_neighbors(T n) const { return {n, out_offset, out_neigh}; }
-    Neighborhood in_neighbors(T n) const { return {n, in_offset, in_neigh}; }
+    Neighborhood in_neighbors(T n) const { ensure_transpose(); return {n, in_offset, in_neigh}; }
+    /**
+     * The whole neighborhood in id order; for upper triangular graphs the lower half (the
+     * transpose) followed by the upper half, otherwise the out-neighbors.
+     */
+    FullNeighborhood full_neighbors(T n) const {
+        DstT const *out_begin = out_neigh + out_offset[n];
+        DstT const *out_end = out_neigh + out_offset[n + 1];
+        if (!upper_triangular) {
+            return {out_begin, out_begin, out_begin, out_end};
+        }
+        ensure_transpose();
+        return {in_neigh + in_offset[n], in_neigh + in_offset[n + 1], out_begin, out_end};
+    }
+    offset_t full_degree(T n) const {
+        return upper_triangular ? out_degree(n) + in_degree(n) : out_degree(n);
+    }
+    [[nodiscard]] bool has_transpose() const {
+        return !directed || transpose_state->ready.load(std::memory_order_acquire);
+    }
+    /**
+     * Build the in-CSR of a directed graph in parallel, once; later and concurrent calls wait
+     * for it or return at once. in_neighbors/in_degree/get_in_offset call it implicitly.
+     */
+    void build_transpose() const;
+    /**
+     * Order every neighborhood (the in-neighborhoods too for directed graphs) by the out-degree
+     * of the neighbors, comp(degree_a, degree_b) meaning a comes first. Ties are left in no
+     * particular order, but the same one for the same input and any number of threads.
+     */
     template<typename Comp>
     void sort_neighborhood(Comp comp);
+    /**
+     * The same with an arbitrary score per vertex as the key, key[v] for neighbor v.
+     */
+    template<typename KeyT, typename Comp>
+    void sort_neighborhood(KeyT const *key, Comp comp);
 
     template<typename TT, typename DstTT>
     friend Graph<TT, DstTT> simplify_graph(Graph<TT, DstTT> &raw);
 };
 
+/**
+ * For kernels that follow out_neighbors as the whole neighborhood, which an upper triangular
+ * graph only holds the part above each vertex of.
+ */
+template<typename T, typename DstT>
+void require_full_storage(Graph<T, DstT> const &graph, char const *kernel) {
+    if (graph.is_upper_triangular()) {
+        throw std::invalid_argument(std::string(kernel) + " does not take upper triangular graphs");
+    }
+}
+
 template<typename T, typename DstT>
 Graph<T, DstT>::Graph(int64_t vertex_number, offset_t *&out_offset, DstT *&out_neigh)
     : directed{false}, vertex_number{vertex_number} {
@@ -77,24 +197,86 @@ Graph<T, DstT>::Graph(int64_t vertex_number, offset_t *&out_offset, DstT *&out_n
     edge_number = (this->out_offset[vertex_number] - this->out_offset[0]) / 2;
 }
 
+template<typename T, typename DstT>
+Graph<T, DstT>::Graph(int64_t vertex_number, offset_t *&out_offset, DstT *&out_neigh, bool directed)
+    : Graph<T, DstT>{vertex_number, out_offset, out_neigh} {
+    if (directed) {
+        this->directed = true;
+        this->in_offset = nullptr;
+        this->in_neigh = nullptr;
+        transpose_state = std::make_unique<TransposeState>();
+        edge_number = this->out_offset[vertex_number] - this->out_offset[0];
+    }
+}
+
+template<typename T, typename DstT>
+Graph<T, DstT> Graph<T, DstT>::upper_triangular_graph(int64_t vertex_number, offset_t *&out_offset, DstT *&out_neigh) {
+    Graph<T, DstT> graph{vertex_number, out_offset, out_neigh, true};
+    graph.upper_triangular = true;
+    return graph;
+}
+
 template<typename T, typename DstT>
 Graph<T, DstT>::Graph(int64_t vertex_number, offset_t *&out_offset, DstT *&out_neigh,
                       offset_t *&in_offset, DstT *&in_neigh)
-    : Graph<T, DstT>{vertex_number, out_offset, out_neigh} {
-    this->directed = true;
+    : Graph<T, DstT>{vertex_number, out_offset, out_neigh, true} {
     this->in_offset = std::exchange(in_offset, nullptr);
     this->in_neigh = std::exchange(in_neigh, nullptr);
-    edge_number = this->out_offset[vertex_number] - this->out_offset[0];
+    transpose_state->ready = true;
+}
+
+template<typename T, typename DstT>
+void Graph<T, DstT>::build_transpose() const {
+    if (!directed) {
+        return;
+    }
+    std::call_once(transpose_state->once, [this] {
+        std::vector<offset_t> in_degrees(vertex_number, 0);
+#pragma omp parallel for default(shared)
+        for (T u = 0; u < vertex_number; ++u) {
+            for (DstT const &v : out_neighbors(u)) {
+                fetch_and_add(in_degrees[get_dst_id(v)], 1);
+            }
+        }
+        offset_t *offset = new offset_t[vertex_number + 1];
+        offset_t curr{};
+        for (T v = 0; v < vertex_number; ++v) {
+            offset[v] = curr;
+            curr += in_degrees[v];
+        }
+        offset[vertex_number] = curr;
+        DstT *neigh = new DstT[curr];
+        std::copy(offset, offset + vertex_number, in_degrees.begin());
+#pragma omp parallel for default(shared)
+        for (T u = 0; u < vertex_number; ++u) {
+            for (DstT const &v : out_neighbors(u)) {
+                DstT w = v;
+                get_dst_id(w) = u;
+                neigh[fetch_and_add(in_degrees[get_dst_id(v)], 1)] = w;
+            }
+        }
+#pragma omp parallel for default(shared) schedule(dynamic, 1024)
+        for (T v = 0; v < vertex_number; ++v) {
+            std::sort(neigh + offset[v], neigh + offset[v + 1], [](DstT const &lhs, DstT const &rhs) {
+                return get_dst_id(lhs) < get_dst_id(rhs);
+            });
+        }
+        in_offset = offset;
+        in_neigh = neigh;
+        transpose_state->ready.store(true, std::memory_order_release);
+    });
 }
 
 template<typename T, typename DstT>
 Graph<T, DstT>::Graph(Graph<T, DstT> &&graph) noexcept
-    : directed{std::move(graph.directed)}, vertex_number{std::move(graph.vertex_number)},
+    : directed{std::move(graph.directed)}, upper_triangular{graph.upper_triangular},
+    vertex_number{std::move(graph.vertex_number)},
     edge_number{std::move(graph.edge_number)} {
     out_offset = std::exchange(graph.out_offset, nullptr);
     out_neigh = std::exchange(graph.out_neigh, nullptr);
     in_offset = std::exchange(graph.in_offset, nullptr);
     in_neigh = std::exchange(graph.in_neigh, nullptr);
+    transpose_state = std::move(graph.transpose_state);
 }
 
 template<typename T, typename DstT>
@@ -118,39 +300,145 @@ Graph<T, DstT> &Graph<T, DstT>::operator=(Graph<T, DstT> &&other) noexcept {
         delete[] this->in_neigh;
     }
     this->directed = std::exchange(other.directed, false);
+    this->upper_triangular = std::exchange(other.upper_triangular, false);
     this->vertex_number = std::exchange(other.vertex_number, 0);
     this->edge_number = std::exchange(other.edge_number, 0);
     this->out_offset = std::exchange(other.out_offset, nullptr);
     this->out_neigh = std::exchange(other.out_neigh, nullptr);
     this->in_offset = std::exchange(other.in_offset, nullptr);
     this->in_neigh = std::exchange(other.in_neigh, nullptr);
+    this->transpose_state = std::move(other.transpose_state);
     return *this;
 }
 
+// neighborhoods up to this degree are insertion sorted, above the hub degree sorted in parallel
+constexpr size_t neighborhood_small_degree = 32;
+constexpr size_t neighborhood_hub_degree = 1 << 16;
+constexpr size_t neighborhood_sort_block = 1 << 14;
+
+/**
+ * Sort the n (key, neighbor) pairs at pairs with less, blocks in parallel and then merged
+ * pairwise in parallel rounds, through buffer.
+ */
+template<typename Pair, typename Less>
+void parallel_sort_pairs(Pair *pairs, size_t n, std::vector<Pair> &buffer, Less less) {
+    size_t const blocks = (n + neighborhood_sort_block - 1) / neighborhood_sort_block;
+#pragma omp parallel for default(shared) schedule(dynamic, 1)
+    for (size_t b = 0; b < blocks; ++b) {
+        std::sort(pairs + b * neighborhood_sort_block, pairs + std::min(n, (b + 1) * neighborhood_sort_block), less);
+    }
+    buffer.resize(n);
+    Pair *src = pairs;
+    Pair *dst = buffer.data();
+    for (size_t width = neighborhood_sort_block; width < n; width *= 2) {
+        size_t const merges = (n + 2 * width - 1) / (2 * width);
+#pragma omp parallel for default(shared) schedule(dynamic, 1)
+        for (size_t m = 0; m < merges; ++m) {
+            size_t begin = m * 2 * width;
+            size_t mid = std::min(n, begin + width);
+            size_t end = std::min(n, begin + 2 * width);
+            std::merge(src + begin, src + mid, src + mid, src + end, dst + begin, less);
+        }
+        std::swap(src, dst);
+    }
+    if (src != pairs) {
+        std::copy(src, src + n, pairs);
+    }
+}
+
 template<typename T, typename DstT>
     template<typename Comp>
 void Graph<T, DstT>::sort_neighborhood(Comp comp) {
-    for (T u = 0; u < this->vertex_number; ++u) {
-        std::sort(&out_neigh[out_offset[u]],
-                  &out_neigh[out_offset[u + 1]],
-                  [&](T const &lhs, T const &rhs) { return comp(out_degree(lhs), out_degree(rhs)); });
+    // one degree read per vertex here rather than two per comparison
+    std::vector<offset_t> degrees(vertex_number);
+#pragma omp parallel for default(shared)
+    for (T u = 0; u < vertex_number; ++u) {
+        degrees[u] = out_degree(u);
     }
-    if (directed) {
-        for (T u = 0; u < this->vertex_number; ++u) {
-            std::sort(&in_neigh[in_offset[u]],
-                      &in_neigh[in_offset[u + 1]],
-                      [&](T const &lhs, T const &rhs) { return comp(out_degree(lhs), out_degree(rhs)); });
+    sort_neighborhood(degrees.data(), comp);
+}
+
+template<typename T, typename DstT>
+    template<typename KeyT, typename Comp>
+void Graph<T, DstT>::sort_neighborhood(KeyT const *key, Comp comp) {
+    typedef std::pair<KeyT, DstT> KeyNNeighbor;
+    auto less = [comp](KeyNNeighbor const &lhs, KeyNNeighbor const &rhs) { return comp(lhs.first, rhs.first); };
+    // the keys are gathered once per edge, then the pairs sorted and the neighbors written back
+    auto sort_csr = [&](offset_t const *offset, DstT *neigh) {
+        std::vector<T> hubs;
+#pragma omp parallel default(shared)
+        {
+            std::vector<KeyNNeighbor> pairs;
+            std::vector<T> local_hubs;
+#pragma omp for schedule(dynamic, 256) nowait
+            for (T u = 0; u < vertex_number; ++u) {
+                size_t const degree = offset[u + 1] - offset[u];
+                if (degree > neighborhood_hub_degree) {
+                    local_hubs.emplace_back(u);
+                    continue;
+                }
+                if (degree < 2) {
+                    continue;
+                }
+                DstT *first = neigh + offset[u];
+                pairs.resize(degree);
+                for (size_t i = 0; i < degree; ++i) {
+                    pairs[i] = {key[get_dst_id(first[i])], first[i]};
+                }
+                if (degree <= neighborhood_small_degree) {
+                    for (size_t i = 1; i < degree; ++i) {
+                        KeyNNeighbor curr = pairs[i];
+                        size_t j = i;
+                        for (; j > 0 && less(curr, pairs[j - 1]); --j) {
+                            pairs[j] = pairs[j - 1];
+                        }
+                        pairs[j] = curr;
+                    }
+                } else {
+                    std::sort(pairs.begin(), pairs.end(), less);
+                }
+                for (size_t i = 0; i < degree; ++i) {
+                    first[i] = pairs[i].second;
+                }
+            }
+#pragma omp critical
+            hubs.insert(hubs.end(), local_hubs.begin(), local_hubs.end());
+        }
+        // hubs one at a time, each sorted by all threads
+        std::vector<KeyNNeighbor> pairs, buffer;
+        for (T u : hubs) {
+            size_t const degree = offset[u + 1] - offset[u];
+            DstT *first = neigh + offset[u];
+            pairs.resize(degree);
+#pragma omp parallel for default(shared)
+            for (size_t i = 0; i < degree; ++i) {
+                pairs[i] = {key[get_dst_id(first[i])], first[i]};
+            }
+            parallel_sort_pairs(pairs.data(), degree, buffer, less);
+#pragma omp parallel for default(shared)
+            for (size_t i = 0; i < degree; ++i) {
+                first[i] = pairs[i].second;
+            }
         }
+    };
+    sort_csr(out_offset, out_neigh);
+    if (directed) {
+        build_transpose();
+        sort_csr(in_offset, in_neigh);
     }
 }
 
+/**
+ * Relabel by decreasing degree, the full degree for upper triangular graphs, which stay upper
+ * triangular: each stored edge goes to the smaller of its two new ids.
+ */
 template<typename T, typename DstT>
 std::tuple<Graph<T, DstT>, std::vector<T>, std::vector<T>> reorder_by_degree(Graph<T, DstT> const &g) {
     typedef typename Graph<T, DstT>::offset_t offset_t;
     typedef std::pair<offset_t, T> DegreeNVertex;
     std::vector<DegreeNVertex> degree_vertex_pairs;
     for (int i = 0; i < g.get_vertex_number(); ++i) {
-        degree_vertex_pairs.emplace_back(g.out_degree(i), i);
+        degree_vertex_pairs.emplace_back(g.full_degree(i), i);
     }
     std::sort(degree_vertex_pairs.begin(), degree_vertex_pairs.end(), std::greater<DegreeNVertex>());
     int64_t vertex_number = g.get_vertex_number();
@@ -162,6 +450,14 @@ std::tuple<Graph<T, DstT>, std::vector<T>, std::vector<T>> reorder_by_degree(Gra
         new_ids[degree_vertex_pairs[i].second] = i;
         new_ids_remap[i] = degree_vertex_pairs[i].second;
     }
+    if (g.is_upper_triangular()) {
+        std::fill(out_degrees.begin(), out_degrees.end(), 0);
+        for (int u = 0; u < vertex_number; ++u) {
+            for (DstT const &v : g.out_neighbors(u)) {
+                out_degrees[std::min(new_ids[u], new_ids[get_dst_id(v)])]++;
+            }
+        }
+    }
     offset_t *out_offset = new offset_t[vertex_number + 1];
     offset_t curr{};
     for (int i = 0; i < vertex_number; ++i) {
@@ -173,6 +469,25 @@ std::tuple<Graph<T, DstT>, std::vector<T>, std::vector<T>> reorder_by_degree(Gra
     DstT *out_neigh = new DstT[edge_number];
     offset_t *tmp = new offset_t[vertex_number + 1];
     std::copy(out_offset, out_offset + (vertex_number + 1), tmp);
+    if (g.is_upper_triangular()) {
+        for (int u = 0; u < vertex_number; ++u) {
+            for (DstT const &v : g.out_neighbors(u)) {
+                T a = new_ids[u];
+                T b = new_ids[get_dst_id(v)];
+                DstT w = v;
+                get_dst_id(w) = std::max(a, b);
+                out_neigh[tmp[std::min(a, b)]++] = w;
+            }
+        }
+        for (int u = 0; u < vertex_number; ++u) {
+            std::sort(&out_neigh[out_offset[u]],
+                      &out_neigh[out_offset[u+1]],
+                      [](DstT const &lhs, DstT const &rhs) { return get_dst_id(lhs) < get_dst_id(rhs); });
+        }
+        delete[] tmp;
+        return {Graph<T, DstT>::upper_triangular_graph(vertex_number, out_offset, out_neigh),
+                std::move(new_ids), std::move(new_ids_remap)};
+    }
     for (int u = 0; u < vertex_number; ++u) {
         for (DstT const &v : g.out_neighbors(u)) {
             out_neigh[tmp[new_ids[u]]] = new_ids[get_dst_id(v)];
@@ -252,6 +567,15 @@ std::tuple<Graph<T, DstT>, std::vector<T>, std::vector<T>> squeeze_graph(Graph<T
                   &out_neigh[out_offset[u+1]],
                   [](DstT const &lhs, DstT const &rhs) { return get_dst_id(lhs) < get_dst_id(rhs); });
     }
+    if (g.is_upper_triangular()) {
+        // vertex_map is monotone, so every stored edge still goes from a smaller to a larger id
+        delete[] tmp;
+        return {
+            Graph<T, DstT>::upper_triangular_graph(squeezed_vertex_number, out_offset, out_neigh),
+            std::move(vertex_map),
+            std::move(vertex_remap)
+        };
+    }
     if (!g.is_directed()) {
         delete[] tmp;
         return {
@@ -318,6 +642,13 @@ Graph<T, DstT> simplify_graph(Graph<T, DstT> &raw) {
     if (!raw.directed) {
         return {vertex_number, out_offset, out_neigh};
     }
+    if (raw.upper_triangular) {
+        return Graph<T, DstT>::upper_triangular_graph(vertex_number, out_offset, out_neigh);
+    }
+    if (!raw.has_transpose()) {
+        // the simplified graph builds its own in-CSR when it needs one
+        return {vertex_number, out_offset, out_neigh, true};
+    }
     std::vector<offset_t> in_degrees(vertex_number, 0);
     for (T u = 0; u < vertex_number; ++u) {
         in_degrees[u] = std::distance(&raw.in_neigh[raw.in_offset[u]], 
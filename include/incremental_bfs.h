@@ -0,0 +1,206 @@
+#ifndef EXPERIMENT_INCREMENTAL_BFS_H
+#define EXPERIMENT_INCREMENTAL_BFS_H
+
+#include "graph.h"
+#include "bfs.h"
+#include <vector>
+#include <queue>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+template<typename T, typename DstT = T>
+using EdgeBatch = std::vector<std::pair<T, DstT>>;
+
+/**
+ * Build a new CSR with a batch of edge updates applied. A deleted edge removes every
+ * copy of (u, v). For undirected graphs both directions must be given, in the same way
+ * Builder emits them for symmetric input.
+ */
+template<typename T, typename DstT>
+Graph<T, DstT> apply_edge_updates(Graph<T, DstT> const &g,
+                                  EdgeBatch<T, DstT> const &inserted,
+                                  EdgeBatch<T, DstT> const &deleted) {
+    typedef typename Graph<T, DstT>::offset_t offset_t;
+    typedef std::pair<T, DstT> Edge;
+    auto edge_less = [](Edge const &lhs, Edge const &rhs) {
+        return std::make_pair(lhs.first, get_dst_id(lhs.second))
+               < std::make_pair(rhs.first, get_dst_id(rhs.second));
+    };
+    int64_t vertex_number = g.get_vertex_number();
+    for (auto const &[u, v] : inserted) {
+        vertex_number = std::max<int64_t>(vertex_number, std::max<int64_t>(u, get_dst_id(v)) + 1);
+    }
+
+    auto patch = [&](EdgeBatch<T, DstT> ins, EdgeBatch<T, DstT> del, auto neighbors_of,
+                     offset_t *&offset, DstT *&neigh) {
+        std::sort(ins.begin(), ins.end(), edge_less);
+        std::sort(del.begin(), del.end(), edge_less);
+        auto is_deleted = [&](T u, DstT const &v) {
+            return std::binary_search(del.begin(), del.end(), Edge{u, v}, edge_less);
+        };
+        std::vector<offset_t> degrees(vertex_number, 0);
+        for (T u = 0; u < g.get_vertex_number(); ++u) {
+            for (DstT const &v : neighbors_of(u)) {
+                degrees[u] += !is_deleted(u, v);
+            }
+        }
+        for (auto const &[u, v] : ins) {
+            degrees[u]++;
+        }
+        offset = new offset_t[vertex_number + 1];
+        offset_t curr{};
+        for (int64_t u = 0; u < vertex_number; ++u) {
+            offset[u] = curr;
+            curr += degrees[u];
+        }
+        offset[vertex_number] = curr;
+        neigh = new DstT[curr];
+        auto ins_it = ins.begin();
+        for (T u = 0; u < vertex_number; ++u) {
+            offset_t pos = offset[u];
+            if (u < g.get_vertex_number()) {
+                for (DstT const &v : neighbors_of(u)) {
+                    if (!is_deleted(u, v)) {
+                        neigh[pos++] = v;
+                    }
+                }
+            }
+            for (; ins_it != ins.end() && ins_it->first == u; ++ins_it) {
+                neigh[pos++] = ins_it->second;
+            }
+            std::sort(&neigh[offset[u]], &neigh[offset[u + 1]],
+                      [](DstT const &lhs, DstT const &rhs) { return get_dst_id(lhs) < get_dst_id(rhs); });
+        }
+    };
+
+    offset_t *out_offset;
+    DstT *out_neigh;
+    patch(inserted, deleted, [&](T u) { return g.out_neighbors(u); }, out_offset, out_neigh);
+    if (!g.is_directed()) {
+        return {vertex_number, out_offset, out_neigh};
+    }
+    auto reversed = [](EdgeBatch<T, DstT> const &batch) {
+        EdgeBatch<T, DstT> rev;
+        rev.reserve(batch.size());
+        for (auto const &[u, v] : batch) {
+            DstT w = v;
+            get_dst_id(w) = u;
+            rev.emplace_back(get_dst_id(v), w);
+        }
+        return rev;
+    };
+    offset_t *in_offset;
+    DstT *in_neigh;
+    patch(reversed(inserted), reversed(deleted), [&](T u) { return g.in_neighbors(u); }, in_offset, in_neigh);
+    return {vertex_number, out_offset, out_neigh, in_offset, in_neigh};
+}
+
+/**
+ * Repair the depth vector of a BFS from root after a batch of edge updates.
+ * graph must already contain the updates (see apply_edge_updates) and depth must be the
+ * result for the graph before the updates. Deletions invalidate the vertices that lost their
+ * last parent, transitively; once more than invalidation_limit * V vertices are invalidated,
+ * the repair gives up and falls back to a full do_bfs. Invalidated vertices and the heads of
+ * inserted edges are then settled in depth order, which also propagates decreased depths.
+ * Returns the number of vertices re-examined.
+ */
+template<typename T, typename DstT, typename PropT>
+long long repair_bfs(Graph<T, DstT> const &graph, T root, std::vector<PropT> &depth,
+                     EdgeBatch<T, DstT> const &inserted,
+                     EdgeBatch<T, DstT> const &deleted,
+                     double invalidation_limit = 0.1) {
+    require_full_storage(graph, "repair_bfs");
+    depth.resize(graph.get_vertex_number(), get_max_prop<PropT>());
+    auto has_parent = [&](T v) {
+        for (auto const &w : graph.in_neighbors(v)) {
+            if (!is_max_prop(depth[get_dst_id(w)]) && depth[get_dst_id(w)] + 1 == depth[v]) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // invalidation
+    std::vector<std::pair<T, PropT>> invalidated;
+    std::vector<std::pair<T, PropT>> stack;
+    // depths before the batch of the vertices invalidated so far, the others still have theirs
+    std::unordered_map<T, PropT> old_depths;
+    auto old_depth_of = [&](T v) {
+        auto it = old_depths.find(v);
+        return (it == old_depths.end()) ? depth[v] : it->second;
+    };
+    auto try_invalidate = [&](T v) {
+        if (v == root || is_max_prop(depth[v]) || has_parent(v)) {
+            return;
+        }
+        stack.emplace_back(v, depth[v]);
+        invalidated.emplace_back(v, depth[v]);
+        old_depths.emplace(v, depth[v]);
+        depth[v] = get_max_prop<PropT>();
+    };
+    auto const limit = static_cast<size_t>(invalidation_limit * graph.get_vertex_number());
+    for (auto const &[u, v] : deleted) {
+        T dst = get_dst_id(v);
+        // u may already be invalidated by an earlier deletion of the batch, and its walk over
+        // the updated out-edges could not see (u, v) any more
+        PropT du = old_depth_of(u);
+        PropT dv = old_depth_of(dst);
+        if (!is_max_prop(du) && !is_max_prop(dv) && du + 1 == dv) {
+            try_invalidate(dst);
+        }
+        while (!stack.empty()) {
+            auto [x, old_depth] = stack.back(); stack.pop_back();
+            for (auto const &y : graph.out_neighbors(x)) {
+                if (!is_max_prop(depth[get_dst_id(y)]) && depth[get_dst_id(y)] == old_depth + 1) {
+                    try_invalidate(get_dst_id(y));
+                }
+            }
+            if (invalidated.size() > limit) {
+                depth = do_bfs<T, DstT, PropT>(graph, root);
+                return graph.get_vertex_number();
+            }
+        }
+    }
+
+    // recomputation, in increasing depth order
+    typedef std::pair<PropT, T> DepthNVertex;
+    std::priority_queue<DepthNVertex, std::vector<DepthNVertex>, std::greater<>> pending;
+    for (auto const &[v, old_depth] : invalidated) {
+        PropT best = get_max_prop<PropT>();
+        for (auto const &w : graph.in_neighbors(v)) {
+            PropT d = depth[get_dst_id(w)];
+            if (!is_max_prop(d) && (is_max_prop(best) || d + 1 < best)) {
+                best = d + 1;
+            }
+        }
+        if (!is_max_prop(best)) {
+            pending.emplace(best, v);
+        }
+    }
+    for (auto const &[u, v] : inserted) {
+        T dst = get_dst_id(v);
+        if (!is_max_prop(depth[u]) && (is_max_prop(depth[dst]) || depth[u] + 1 < depth[dst])) {
+            pending.emplace(depth[u] + 1, dst);
+        }
+    }
+    long long touched = static_cast<long long>(invalidated.size());
+    while (!pending.empty()) {
+        auto [d, v] = pending.top(); pending.pop();
+        if (!is_max_prop(depth[v]) && depth[v] <= d) {
+            continue;
+        }
+        depth[v] = d;
+        touched++;
+        for (auto const &w : graph.out_neighbors(v)) {
+            T x = get_dst_id(w);
+            if (is_max_prop(depth[x]) || d + 1 < depth[x]) {
+                pending.emplace(d + 1, x);
+            }
+        }
+    }
+    return touched;
+}
+
+#endif //EXPERIMENT_INCREMENTAL_BFS_H
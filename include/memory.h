@@ -4,8 +4,8 @@
 #include "bitmap.h"
 #include "graph.h"
 #include <vector>
-#include <ranges>
 #include <numeric>
+#include <omp.h>
 
 constexpr int cacheline_edge_num = 16;
 
@@ -26,68 +26,124 @@ constexpr SizeT cal_mem_size(GraphT const &graph) {
                 + get_aligned_size(graph.get_edge_number()));
 }
 
+/**
+ * out[0] = 0, out[i + 1] = value(0) + ... + value(i) for i in [0, n), built in parallel: every
+ * thread sums its own range, then adds the total of the ranges before it.
+ */
+template<typename T, typename F>
+void parallel_prefix_fill(std::vector<T> &out, int64_t n, F &&value) {
+    out.assign(n + 1, 0);
+    std::vector<T> block_sum;
+#pragma omp parallel default(shared)
+    {
+        int threads = omp_get_num_threads();
+        int tid = omp_get_thread_num();
+#pragma omp single
+        block_sum.assign(threads + 1, 0);
+        int64_t begin = n * tid / threads;
+        int64_t end = n * (tid + 1) / threads;
+        T sum{};
+        for (int64_t i = begin; i < end; ++i) {
+            sum += value(i);
+            out[i + 1] = sum;
+        }
+        block_sum[tid + 1] = sum;
+#pragma omp barrier
+#pragma omp single
+        std::partial_sum(block_sum.begin(), block_sum.end(), block_sum.begin());
+        for (int64_t i = begin; i < end; ++i) {
+            out[i + 1] += block_sum[tid];
+        }
+    }
+}
+
+/**
+ * Address layout of the simulated in-edge array: the first in-neighbor of every vertex goes
+ * to a vertex-indexed block, the remaining ones to an edge block. It only depends on the graph,
+ * so one read-only instance is shared by all threads.
+ */
 template<typename T>
-class Memory {
+class MemoryLayout {
 private:
-    Bitmap bmp;
     std::vector<T> accum_edge_off;
     std::vector<T> accum_iso_v_num;
     T mem_block_1_st;
     T mem_block_2_st;
+    T cacheline_num;
 public:
     template<typename U, typename DstU>
-    explicit Memory(Graph<U, DstU> const &graph)
-        : bmp{cal_mem_size<T, Graph<U, DstU>>(graph)/cacheline_edge_num},
-        mem_block_1_st{0}, mem_block_2_st{get_aligned_size<T>(graph.get_vertex_number())} {
-        bmp.reset();
-        load_graph(graph);
+    explicit MemoryLayout(Graph<U, DstU> const &graph)
+        : mem_block_1_st{0}, mem_block_2_st{get_aligned_size<T>(graph.get_vertex_number())},
+        cacheline_num{cal_mem_size<T, Graph<U, DstU>>(graph) / cacheline_edge_num} {
+        parallel_prefix_fill(accum_edge_off, graph.get_vertex_number(), [&graph](int64_t u) {
+            return static_cast<T>((graph.in_degree(u) > 0) ? (graph.in_degree(u) - 1) : 0);
+        });
+        parallel_prefix_fill(accum_iso_v_num, graph.get_vertex_number(), [&graph](int64_t u) {
+            return static_cast<T>(graph.in_degree(u) == 0);
+        });
     }
-    template<typename U, typename DstU>
-    void load_graph(Graph<U, DstU> const &graph);
     template<typename U, typename V>
-    int access(U vid, V offset);
-    template<typename U, typename V>
-    T get_addr(U vid, V offset);
-    void reset() {
-        bmp.reset();
+    T get_addr(U vid, V offset) const {
+        return (offset == 0) ?
+               (mem_block_1_st + vid - accum_iso_v_num[vid])
+               : (mem_block_2_st + accum_edge_off[vid] + offset - 1);
     }
+    [[nodiscard]] T get_cacheline_number() const { return cacheline_num; }
     template<typename U, typename DstU>
-    void check(Graph<U, DstU> const &graph);
+    void check(Graph<U, DstU> const &graph) const;
 };
 
-template<typename T>
-    template<typename U, typename DstU>
-void Memory<T>::load_graph(Graph<U, DstU> const &graph) {
-    accum_iso_v_num.reserve(graph.get_vertex_number() + 1);
-    accum_edge_off.reserve(graph.get_vertex_number() + 1);
-    accum_iso_v_num.emplace_back(0);
-    accum_edge_off.emplace_back(0);
-    for (auto const u : std::views::iota(0, graph.get_vertex_number())) {
-        accum_edge_off.emplace_back(
-            (graph.in_degree(u) > 0) ? (graph.in_degree(u) - 1) : 0);
-    }
-    for (auto const u : std::views::iota(0, graph.get_vertex_number())) {
-        accum_iso_v_num.emplace_back(graph.in_degree(u) == 0);
-    }
-    std::partial_sum(accum_edge_off.begin(), accum_edge_off.end(), accum_edge_off.begin(), std::plus<>());
-    std::partial_sum(accum_iso_v_num.begin(), accum_iso_v_num.end(), accum_iso_v_num.begin(), std::plus<>());
-}
+/**
+ * How Memory::reset forgets the touched lines: by clearing the whole bitmap, or only the words
+ * that have been set since the last reset, which costs as much as the iteration touched.
+ */
+enum class ResetMode {full, touched};
 
+/**
+ * Cacheline state of one thread over a shared MemoryLayout: which lines have been touched
+ * since the last reset.
+ */
 template<typename T>
+class Memory {
+private:
+    MemoryLayout<T> const &layout;
+    Bitmap bmp;
+    ResetMode mode;
+    std::vector<size_t> touched_words;
+public:
+    explicit Memory(MemoryLayout<T> const &layout, ResetMode mode = ResetMode::touched)
+        : layout{layout}, bmp{layout.get_cacheline_number()}, mode{mode} {
+        bmp.reset();
+    }
     template<typename U, typename V>
-T Memory<T>::get_addr(U vid, V offset) {
-    return (offset == 0) ?
-           (mem_block_1_st + vid - accum_iso_v_num[vid])
-           : (mem_block_2_st + accum_edge_off[vid] + offset - 1);
-}
+    int access(U vid, V offset);
+    template<typename U, typename V>
+    T get_addr(U vid, V offset) const { return layout.get_addr(vid, offset); }
+    void reset() {
+        if (mode == ResetMode::full) {
+            bmp.reset();
+            return;
+        }
+        uint64_t *words = bmp.data();
+        for (size_t w : touched_words) {
+            words[w] = 0;
+        }
+        touched_words.clear();
+    }
+};
 
 template<typename T>
     template<typename U, typename V>
 int Memory<T>::access(U vid, V offset) {
-    T cacheline_id = get_addr(vid, offset) / cacheline_edge_num;
+    T cacheline_id = layout.get_addr(vid, offset) / cacheline_edge_num;
+    uint64_t &word = bmp.data()[cacheline_id / 64];
+    uint64_t const bit = uint64_t{1} << (cacheline_id % 64);
     int edge_visited{};
-    if (!bmp.get_bit(cacheline_id)) {
-        bmp.set_bit(cacheline_id);
+    if (!(word & bit)) {
+        if (mode == ResetMode::touched && word == 0) {
+            touched_words.emplace_back(cacheline_id / 64);
+        }
+        word |= bit;
         edge_visited = 16;
     } else {
         edge_visited = 0; // or 1?
@@ -97,7 +153,7 @@ int Memory<T>::access(U vid, V offset) {
 
 template<typename T>
 template<typename U, typename DstU>
-void Memory<T>::check(Graph<U, DstU> const &graph) {
+void MemoryLayout<T>::check(Graph<U, DstU> const &graph) const {
     std::vector<int> mem_addr(10000000, 0);
     int now_mem_addr_1 = mem_block_1_st;
     int now_mem_addr_2 = mem_block_2_st;
@@ -0,0 +1,172 @@
+#ifndef EXPERIMENT_PAGERANK_H
+#define EXPERIMENT_PAGERANK_H
+
+#include "graph.h"
+#include "partition.h"
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <type_traits>
+#include <omp.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+constexpr double pagerank_damping = 0.85;
+
+/**
+ * Sum of contrib[idx[i]] for i in [0, n).
+ */
+template<typename DstT, typename ScoreT>
+ScoreT gather_sum(ScoreT const *contrib, DstT const *idx, size_t n) {
+    size_t i{};
+    ScoreT sum{};
+#if defined(__AVX2__)
+    if constexpr (std::is_integral_v<DstT> && sizeof(DstT) == sizeof(int32_t) && std::is_same_v<ScoreT, float>) {
+        __m256 acc = _mm256_setzero_ps();
+        for (; i + 8 <= n; i += 8) {
+            __m256i vi = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(idx + i));
+            acc = _mm256_add_ps(acc, _mm256_i32gather_ps(contrib, vi, sizeof(float)));
+        }
+        __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        half = _mm_hadd_ps(half, half);
+        half = _mm_hadd_ps(half, half);
+        sum = _mm_cvtss_f32(half);
+    } else if constexpr (std::is_integral_v<DstT> && sizeof(DstT) == sizeof(int32_t) && std::is_same_v<ScoreT, double>) {
+        __m256d acc = _mm256_setzero_pd();
+        for (; i + 4 <= n; i += 4) {
+            __m128i vi = _mm_loadu_si128(reinterpret_cast<__m128i const *>(idx + i));
+            acc = _mm256_add_pd(acc, _mm256_i32gather_pd(contrib, vi, sizeof(double)));
+        }
+        __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+        sum = _mm_cvtsd_f64(_mm_hadd_pd(half, half));
+    }
+#endif
+    for (; i < n; ++i) {
+        sum += contrib[get_dst_id(idx[i])];
+    }
+    return sum;
+}
+
+/**
+ * Pull-based PageRank over in_neighbors. Contributions (score / out_degree) are computed
+ * once per iteration into a contiguous array, so the per-edge work is a single gather.
+ * Each thread owns one chunk of an edge-balanced partition of the in-edges (partition.h).
+ * The in-neighborhoods of hubs may be cut between chunks; their partial sums are kept per
+ * chunk and added up after the parallel loop.
+ */
+template<typename T, typename DstT = T, typename ScoreT = float>
+class PageRank {
+public:
+    typedef typename Graph<T, DstT>::offset_t offset_t;
+private:
+    struct Partial {
+        T v;
+        ScoreT sum;
+        bool used;
+    };
+    Graph<T, DstT> const &graph;
+    std::vector<ScoreT> scores;
+    std::vector<ScoreT> contrib;
+    EdgePartition<T, offset_t> partition;
+    // slots for the cut vertex a chunk starts with and the one it ends with
+    std::vector<Partial> partials;
+public:
+    explicit PageRank(Graph<T, DstT> const &graph)
+        : graph{graph}, scores(graph.get_vertex_number(), ScoreT(1) / graph.get_vertex_number()),
+        contrib(graph.get_vertex_number(), 0),
+        partition{edge_balanced_partition<T>(graph.get_in_offset(), graph.get_vertex_number(), omp_get_max_threads())},
+        partials(2 * partition.size()) {}
+    void reset() {
+        std::fill(scores.begin(), scores.end(), ScoreT(1) / graph.get_vertex_number());
+    }
+    /**
+     * One iteration, returns the L1 change of the scores.
+     */
+    double iterate();
+    /**
+     * Iterate until the L1 change drops below tolerance, returns the number of iterations.
+     */
+    int run(double tolerance = 1e-4, int max_iters = 20) {
+        for (int iter = 1; iter <= max_iters; ++iter) {
+            if (iterate() < tolerance) {
+                return iter;
+            }
+        }
+        return max_iters;
+    }
+    [[nodiscard]] std::vector<ScoreT> const &get_scores() const { return scores; }
+    /**
+     * Bytes streamed per iteration for the edges: one neighbor id and one gathered contribution.
+     */
+    [[nodiscard]] double edge_bytes() const {
+        return static_cast<double>(graph.get_in_offset()[graph.get_vertex_number()]) * (sizeof(DstT) + sizeof(ScoreT));
+    }
+};
+
+template<typename T, typename DstT, typename ScoreT>
+double PageRank<T, DstT, ScoreT>::iterate() {
+    ScoreT const base = (1 - pagerank_damping) / graph.get_vertex_number();
+    offset_t const *offset = graph.get_in_offset();
+    // all in-neighborhoods are slices of one array
+    DstT const *in_neigh = graph.in_neighbors(0).begin() - offset[0];
+    double error{};
+#pragma omp parallel default(shared) reduction(+ : error)
+    {
+#pragma omp for
+        for (T u = 0; u < graph.get_vertex_number(); ++u) {
+            auto degree = graph.out_degree(u);
+            contrib[u] = (degree > 0) ? scores[u] / degree : 0;
+        }
+#pragma omp for schedule(static, 1)
+        for (size_t p = 0; p < partition.size(); ++p) {
+            partials[2 * p].used = partials[2 * p + 1].used = false;
+            partition.for_each_vertex(p, offset, [&](T v, offset_t begin, offset_t end, bool whole) {
+                ScoreT incoming = gather_sum(contrib.data(), in_neigh + begin, end - begin);
+                if (!whole) {
+                    partials[2 * p + (v != partition.chunks[p].first)] = {v, incoming, true};
+                    return;
+                }
+                ScoreT updated = base + static_cast<ScoreT>(pagerank_damping) * incoming;
+                error += std::fabs(updated - scores[v]);
+                scores[v] = updated;
+            });
+        }
+    }
+    // the partial sums of a cut vertex are in consecutive slots
+    for (size_t i = 0; i < partials.size();) {
+        if (!partials[i].used) {
+            i++;
+            continue;
+        }
+        T v = partials[i].v;
+        ScoreT incoming{};
+        for (; i < partials.size() && (!partials[i].used || partials[i].v == v); ++i) {
+            if (partials[i].used) {
+                incoming += partials[i].sum;
+            }
+        }
+        ScoreT updated = base + static_cast<ScoreT>(pagerank_damping) * incoming;
+        error += std::fabs(updated - scores[v]);
+        scores[v] = updated;
+    }
+    return error;
+}
+
+/**
+ * Fixed-iteration run, returns {milliseconds per iteration, GB/s of edge traffic}.
+ */
+template<typename T, typename DstT, typename ScoreT = float>
+std::tuple<double, double> benchmark_pagerank(Graph<T, DstT> const &graph, int iters = 20) {
+    PageRank<T, DstT, ScoreT> pr{graph};
+    pr.iterate(); // warm up
+    pr.reset();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; ++i) {
+        pr.iterate();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / iters;
+    return {seconds * 1e3, pr.edge_bytes() / seconds / 1e9};
+}
+
+#endif //EXPERIMENT_PAGERANK_H
@@ -0,0 +1,142 @@
+#ifndef EXPERIMENT_PARTITION_H
+#define EXPERIMENT_PARTITION_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * Edge-balanced work partitioning of a CSR. Each part is a vertex range together with the
+ * range of edge positions it handles, so that a hub whose neighborhood is larger than the
+ * hub threshold can be cut between consecutive parts, while all other vertices stay whole.
+ * Every vertex also costs one unit of work, so that long runs of low-degree vertices are
+ * balanced as well.
+ */
+
+template<typename T, typename OffsetT>
+struct EdgeChunk {
+    T first;
+    T last;
+    OffsetT edge_begin;
+    OffsetT edge_end;
+};
+
+template<typename T, typename OffsetT>
+struct EdgePartition {
+    std::vector<EdgeChunk<T, OffsetT>> chunks;
+
+    [[nodiscard]] size_t size() const { return chunks.size(); }
+
+    /**
+     * f(v, begin, end, whole) for every vertex of the chunk, with the positions [begin, end) of
+     * the vertex's edges that belong to it, and whether that is all of them. Only the first and
+     * the last vertex can be cut, the ones in between are passed with a constant whole.
+     */
+    template<typename F>
+    void for_each_vertex(size_t p, OffsetT const *offset, F &&f) const {
+        auto const &chunk = chunks[p];
+        if (chunk.first == chunk.last) {
+            return;
+        }
+        auto clipped = [&](T v) {
+            OffsetT begin = std::max(offset[v], chunk.edge_begin);
+            OffsetT end = std::min(offset[v + 1], chunk.edge_end);
+            f(v, begin, end, begin == offset[v] && end == offset[v + 1]);
+        };
+        clipped(chunk.first);
+        for (T v = chunk.first + 1; v + 1 < chunk.last; ++v) {
+            f(v, offset[v], offset[v + 1], true);
+        }
+        if (chunk.last - 1 > chunk.first) {
+            clipped(chunk.last - 1);
+        }
+    }
+};
+
+/**
+ * parts chunks of about (E + V) / parts work each. A cut that falls inside a vertex of degree
+ * above hub_threshold stays there, any other cut moves to the start of that vertex.
+ */
+template<typename T, typename OffsetT>
+EdgePartition<T, OffsetT> edge_balanced_partition(OffsetT const *offset, int64_t vertex_number, int parts,
+                                                  OffsetT hub_threshold) {
+    // work before vertex v is (offset[v] - offset[0]) + v
+    auto work_before = [offset](int64_t v) { return static_cast<uint64_t>(offset[v] - offset[0]) + v; };
+    uint64_t const total = work_before(vertex_number);
+    std::vector<T> vertex_cut(parts + 1, static_cast<T>(vertex_number));
+    std::vector<OffsetT> edge_cut(parts + 1, offset[vertex_number]);
+    vertex_cut[0] = 0;
+    edge_cut[0] = offset[0];
+    for (int p = 1; p < parts; ++p) {
+        uint64_t target = total * p / parts;
+        // last vertex that starts at or before the target
+        int64_t lo = 0, hi = vertex_number;
+        while (lo < hi) {
+            int64_t mid = lo + (hi - lo + 1) / 2;
+            if (work_before(mid) <= target) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        T v = static_cast<T>(lo);
+        OffsetT edge = offset[v];
+        if (v < vertex_number && offset[v + 1] - offset[v] > hub_threshold) {
+            // inside the hub, past its vertex unit
+            edge = std::min(offset[v + 1], offset[v] + static_cast<OffsetT>(target - std::min(target, work_before(v) + 1)));
+        }
+        if (v < vertex_cut[p - 1] || (v == vertex_cut[p - 1] && edge < edge_cut[p - 1])) {
+            v = vertex_cut[p - 1];
+            edge = edge_cut[p - 1];
+        }
+        vertex_cut[p] = v;
+        edge_cut[p] = edge;
+    }
+    EdgePartition<T, OffsetT> partition;
+    for (int p = 0; p < parts; ++p) {
+        // a chunk that starts inside a hub includes it, the previous one ends with it
+        T last = (edge_cut[p + 1] > offset[vertex_cut[p + 1]]) ? vertex_cut[p + 1] + 1 : vertex_cut[p + 1];
+        partition.chunks.push_back({vertex_cut[p], last, edge_cut[p], edge_cut[p + 1]});
+    }
+    return partition;
+}
+
+/**
+ * The default hub threshold: vertices with more than 1/8 of a chunk's work are cut, so that no
+ * whole vertex can overload a chunk by more than that.
+ */
+template<typename T, typename OffsetT>
+EdgePartition<T, OffsetT> edge_balanced_partition(OffsetT const *offset, int64_t vertex_number, int parts) {
+    auto const total = static_cast<uint64_t>(offset[vertex_number] - offset[0]) + vertex_number;
+    return edge_balanced_partition<T>(offset, vertex_number, parts, static_cast<OffsetT>(total / (8 * parts)));
+}
+
+/**
+ * The plain split of [0, V) into parts equal vertex ranges, for comparison.
+ */
+template<typename T, typename OffsetT>
+EdgePartition<T, OffsetT> vertex_balanced_partition(OffsetT const *offset, int64_t vertex_number, int parts) {
+    EdgePartition<T, OffsetT> partition;
+    for (int p = 0; p < parts; ++p) {
+        T first = static_cast<T>(vertex_number * p / parts);
+        T last = static_cast<T>(vertex_number * (p + 1) / parts);
+        partition.chunks.push_back({first, last, offset[first], offset[last]});
+    }
+    return partition;
+}
+
+/**
+ * Largest chunk work (edges plus vertices) over the mean, 1 is perfect balance.
+ */
+template<typename T, typename OffsetT>
+double partition_imbalance(EdgePartition<T, OffsetT> const &partition) {
+    uint64_t largest{}, total{};
+    for (auto const &chunk : partition.chunks) {
+        uint64_t work = (chunk.edge_end - chunk.edge_begin) + (chunk.last - chunk.first);
+        largest = std::max(largest, work);
+        total += work;
+    }
+    return total ? static_cast<double>(largest) * partition.size() / total : 1;
+}
+
+#endif //EXPERIMENT_PARTITION_H
@@ -0,0 +1,186 @@
+#ifndef EXPERIMENT_SEGMENT_H
+#define EXPERIMENT_SEGMENT_H
+
+#include "graph.h"
+#include "bfs.h"
+#include "bitmap.h"
+#include "pagerank.h"
+#include <vector>
+#include <cmath>
+#include <unistd.h>
+
+/**
+ * Number of source vertices per segment such that their per-vertex data of bytes_per_vertex
+ * bytes takes about half of the last level cache.
+ */
+inline int64_t llc_segment_size(double bytes_per_vertex) {
+    long llc_bytes = -1;
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+    llc_bytes = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+    if (llc_bytes <= 0) {
+        llc_bytes = 8l << 20;
+    }
+    return std::max<int64_t>(64, static_cast<int64_t>(llc_bytes / 2 / bytes_per_vertex));
+}
+
+/**
+ * In-edges partitioned by source vertex range, as in Cagra (Zhang et al., BigData'17).
+ * Segment s holds, for every vertex with an in-edge from [s * segment_size, (s + 1) *
+ * segment_size), those in-neighbors, so a pull kernel that processes one segment at a time
+ * only touches an LLC-sized window of the source-side data.
+ */
+template<typename T, typename DstT = T>
+class SegmentedGraph {
+public:
+    typedef typename Graph<T, DstT>::offset_t offset_t;
+    struct Segment {
+        T src_begin;
+        T src_end;
+        std::vector<T> vertices;            // destinations, ascending
+        std::vector<offset_t> offset;       // into neigh, one entry per destination + 1
+        std::vector<DstT> neigh;            // in-neighbors within [src_begin, src_end)
+    };
+private:
+    int64_t vertex_number;
+    int64_t segment_size;
+    std::vector<Segment> segments;
+public:
+    SegmentedGraph(Graph<T, DstT> const &graph, int64_t segment_size);
+    [[nodiscard]] int64_t get_vertex_number() const { return vertex_number; }
+    [[nodiscard]] int64_t get_segment_size() const { return segment_size; }
+    [[nodiscard]] std::vector<Segment> const &get_segments() const { return segments; }
+};
+
+template<typename T, typename DstT>
+SegmentedGraph<T, DstT>::SegmentedGraph(Graph<T, DstT> const &graph, int64_t segment_size)
+    : vertex_number{graph.get_vertex_number()}, segment_size{segment_size},
+    segments((graph.get_vertex_number() + segment_size - 1) / segment_size) {
+    // the in-edges of a segment are the out-edges of its source range, transposed
+#pragma omp parallel default(shared)
+    {
+        std::vector<offset_t> count(vertex_number, 0);
+#pragma omp for schedule(dynamic, 1)
+        for (size_t s = 0; s < segments.size(); ++s) {
+            Segment &seg = segments[s];
+            seg.src_begin = static_cast<T>(s * segment_size);
+            seg.src_end = static_cast<T>(std::min<int64_t>((s + 1) * segment_size, vertex_number));
+            for (T u = seg.src_begin; u < seg.src_end; ++u) {
+                for (auto const &v : graph.out_neighbors(u)) {
+                    if (count[get_dst_id(v)]++ == 0) {
+                        seg.vertices.emplace_back(get_dst_id(v));
+                    }
+                }
+            }
+            std::sort(seg.vertices.begin(), seg.vertices.end());
+            seg.offset.resize(seg.vertices.size() + 1);
+            offset_t curr{};
+            for (size_t i = 0; i < seg.vertices.size(); ++i) {
+                seg.offset[i] = curr;
+                curr += count[seg.vertices[i]];
+                count[seg.vertices[i]] = i;     // from here on: slot of the destination
+            }
+            seg.offset[seg.vertices.size()] = curr;
+            seg.neigh.resize(curr);
+            std::vector<offset_t> pos(seg.offset.begin(), seg.offset.end() - 1);
+            for (T u = seg.src_begin; u < seg.src_end; ++u) {
+                for (auto const &v : graph.out_neighbors(u)) {
+                    DstT w = v;
+                    get_dst_id(w) = u;
+                    seg.neigh[pos[count[get_dst_id(v)]]++] = w;
+                }
+            }
+            for (T v : seg.vertices) {
+                count[v] = 0;
+            }
+        }
+    }
+}
+
+/**
+ * Pull BFS that sweeps the segments one after another in every iteration. A destination found
+ * in an earlier segment is skipped in the later ones, so merging needs no extra pass.
+ */
+template<typename T, typename DstT, typename PropT = int, typename Observer = NullIterObserver>
+std::vector<PropT> do_segmented_pull_bfs(SegmentedGraph<T, DstT> const &sg, T root, Observer &&observer = {}) {
+    std::vector<PropT> depth(sg.get_vertex_number(), get_max_prop<PropT>());
+    Bitmap front(sg.get_vertex_number());
+    Bitmap next(sg.get_vertex_number());
+    front.reset();
+    next.reset();
+    front.set_bit(root);
+    depth[root] = 0;
+    long long sum = 1;
+    for (PropT iter = 0; sum > 0; ++iter) {
+        IterStats stats{iter, Direction::pull, sum};
+        sum = 0;
+        for (auto const &seg : sg.get_segments()) {
+            long long edges_scanned{};
+#pragma omp parallel for default(shared) schedule(dynamic, 1024) reduction(+ : sum, edges_scanned)
+            for (size_t i = 0; i < seg.vertices.size(); ++i) {
+                T v = seg.vertices[i];
+                if (!is_max_prop(depth[v])) {
+                    continue;
+                }
+                for (auto j = seg.offset[i]; j < seg.offset[i + 1]; ++j) {
+                    edges_scanned++;
+                    if (front.get_bit(get_dst_id(seg.neigh[j]))) {
+                        depth[v] = iter + 1;
+                        next.set_bit_atomic(v);
+                        sum++;
+                        break;
+                    }
+                }
+            }
+            stats.edges_scanned += edges_scanned;
+        }
+        stats.discovered = sum;
+        observer(stats);
+        front.swap(next);
+        next.reset();
+    }
+    return depth;
+}
+
+/**
+ * Pull PageRank over the segments: each segment adds its partial sums into a per-vertex
+ * accumulator (a destination occurs once per segment, so no atomics), and the scores are
+ * updated after the last segment. Stops on the same L1 tolerance as PageRank::run.
+ */
+template<typename T, typename DstT, typename ScoreT = float>
+std::vector<ScoreT> segmented_pagerank(Graph<T, DstT> const &graph, SegmentedGraph<T, DstT> const &sg,
+                                       double tolerance = 1e-4, int max_iters = 20) {
+    int64_t const vertex_number = graph.get_vertex_number();
+    ScoreT const base = (1 - pagerank_damping) / vertex_number;
+    std::vector<ScoreT> scores(vertex_number, ScoreT(1) / vertex_number);
+    std::vector<ScoreT> contrib(vertex_number);
+    std::vector<ScoreT> incoming(vertex_number);
+    for (int iter = 0; iter < max_iters; ++iter) {
+#pragma omp parallel for default(shared)
+        for (T u = 0; u < vertex_number; ++u) {
+            auto degree = graph.out_degree(u);
+            contrib[u] = (degree > 0) ? scores[u] / degree : 0;
+            incoming[u] = 0;
+        }
+        for (auto const &seg : sg.get_segments()) {
+#pragma omp parallel for default(shared) schedule(dynamic, 1024)
+            for (size_t i = 0; i < seg.vertices.size(); ++i) {
+                incoming[seg.vertices[i]] += gather_sum(contrib.data(), seg.neigh.data() + seg.offset[i],
+                                                        seg.offset[i + 1] - seg.offset[i]);
+            }
+        }
+        double error{};
+#pragma omp parallel for default(shared) reduction(+ : error)
+        for (T v = 0; v < vertex_number; ++v) {
+            ScoreT updated = base + static_cast<ScoreT>(pagerank_damping) * incoming[v];
+            error += std::fabs(updated - scores[v]);
+            scores[v] = updated;
+        }
+        if (error < tolerance) {
+            break;
+        }
+    }
+    return scores;
+}
+
+#endif //EXPERIMENT_SEGMENT_H
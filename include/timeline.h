@@ -0,0 +1,87 @@
+#ifndef EXPERIMENT_TIMELINE_H
+#define EXPERIMENT_TIMELINE_H
+
+#include "bfs.h"
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+struct TimelineRecord {
+    int64_t timestamp_ns;
+    IterStats stats;
+};
+
+/**
+ * Fixed-size per-iteration trace of traversal kernels. Records go into a ring buffer that is
+ * allocated up front, so recording from inside a kernel costs one clock read and a copy;
+ * when it is full, the oldest records are overwritten. Formatting happens only when the
+ * trace is dumped after the run. The recorder is itself an iteration observer and can be
+ * passed to any kernel taking one, e.g. do_bfs(graph, root, timeline).
+ */
+class Timeline {
+private:
+    std::vector<TimelineRecord> ring;
+    size_t total;
+    std::chrono::steady_clock::time_point origin;
+public:
+    explicit Timeline(size_t capacity = 1 << 16)
+        : ring(capacity), total{0}, origin{std::chrono::steady_clock::now()} {}
+
+    void operator()(IterStats const &stats) {
+        auto now = std::chrono::steady_clock::now();
+        ring[total % ring.size()] = {
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - origin).count(), stats};
+        total++;
+    }
+    void clear() {
+        total = 0;
+        origin = std::chrono::steady_clock::now();
+    }
+    [[nodiscard]] size_t size() const { return std::min(total, ring.size()); }
+    [[nodiscard]] size_t dropped() const { return total - size(); }
+    /**
+     * i-th retained record, oldest first.
+     */
+    [[nodiscard]] TimelineRecord const &operator[](size_t i) const {
+        return ring[(total - size() + i) % ring.size()];
+    }
+    void dump_csv(std::ostream &out) const;
+    void dump_json(std::ostream &out) const;
+};
+
+inline char const *direction_name(Direction direction) {
+    return (direction == Direction::push) ? "push" : "pull";
+}
+
+inline void Timeline::dump_csv(std::ostream &out) const {
+    out << "timestamp_ns,iter,direction,frontier_vertices,frontier_edges,"
+           "active_vertices,edges_scanned,discovered,cachelines\n";
+    for (size_t i = 0; i < size(); ++i) {
+        auto const &[timestamp, stats] = (*this)[i];
+        out << timestamp << ',' << stats.iter << ',' << direction_name(stats.direction) << ','
+            << stats.frontier_vertices << ',' << stats.frontier_edges << ','
+            << stats.active_vertices << ',' << stats.edges_scanned << ','
+            << stats.discovered << ',' << stats.cachelines << '\n';
+    }
+}
+
+inline void Timeline::dump_json(std::ostream &out) const {
+    out << "{\"dropped\": " << dropped() << ", \"records\": [";
+    for (size_t i = 0; i < size(); ++i) {
+        auto const &[timestamp, stats] = (*this)[i];
+        out << (i ? ",\n  " : "\n  ")
+            << "{\"timestamp_ns\": " << timestamp
+            << ", \"iter\": " << stats.iter
+            << ", \"direction\": \"" << direction_name(stats.direction) << '"'
+            << ", \"frontier_vertices\": " << stats.frontier_vertices
+            << ", \"frontier_edges\": " << stats.frontier_edges
+            << ", \"active_vertices\": " << stats.active_vertices
+            << ", \"edges_scanned\": " << stats.edges_scanned
+            << ", \"discovered\": " << stats.discovered
+            << ", \"cachelines\": " << stats.cachelines << '}';
+    }
+    out << "\n]}\n";
+}
+
+#endif //EXPERIMENT_TIMELINE_H
@@ -0,0 +1,304 @@
+#ifndef EXPERIMENT_TRIANGLE_H
+#define EXPERIMENT_TRIANGLE_H
+
+#include "graph.h"
+#include "atomics.h"
+#include <vector>
+#include <numeric>
+#include <tuple>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Triangle counting and local clustering coefficients on undirected graphs whose
+ * neighborhoods are sorted and deduplicated (build_csr + simplify_graph, or squeeze_graph).
+ * count_triangles and local_clustering also take upper triangular graphs.
+ */
+
+constexpr size_t gallop_ratio = 32;
+
+template<typename DstT>
+size_t intersect_count_merge(DstT const *a, size_t na, DstT const *b, size_t nb) {
+    size_t i{}, j{}, count{};
+    while (i < na && j < nb) {
+        if (get_dst_id(a[i]) < get_dst_id(b[j])) {
+            i++;
+        } else if (get_dst_id(b[j]) < get_dst_id(a[i])) {
+            j++;
+        } else {
+            count++;
+            i++;
+            j++;
+        }
+    }
+    return count;
+}
+
+/**
+ * For |b| >> |a|: exponential search of every element of a in the rest of b.
+ */
+template<typename DstT>
+size_t intersect_count_gallop(DstT const *a, size_t na, DstT const *b, size_t nb) {
+    auto less = [](DstT const &lhs, DstT const &rhs) { return get_dst_id(lhs) < get_dst_id(rhs); };
+    size_t count{};
+    size_t lo{};
+    for (size_t i = 0; i < na && lo < nb; ++i) {
+        size_t step = 1;
+        size_t hi = lo;
+        while (hi < nb && get_dst_id(b[hi]) < get_dst_id(a[i])) {
+            lo = hi + 1;
+            hi += step;
+            step <<= 1;
+        }
+        lo = std::lower_bound(b + lo, b + std::min(hi + 1, nb), a[i], less) - b;
+        if (lo < nb && get_dst_id(b[lo]) == get_dst_id(a[i])) {
+            count++;
+            lo++;
+        }
+    }
+    return count;
+}
+
+#if defined(__AVX512F__)
+inline size_t intersect_count_simd(int32_t const *a, size_t na, int32_t const *b, size_t nb) {
+    size_t i{}, j{}, count{};
+    __m512i const rotate = _mm512_set_epi32(0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+    while (i + 16 <= na && j + 16 <= nb) {
+        __m512i va = _mm512_loadu_si512(a + i);
+        __m512i vb = _mm512_loadu_si512(b + j);
+        __mmask16 match = _mm512_cmpeq_epi32_mask(va, vb);
+        for (int k = 1; k < 16; ++k) {
+            vb = _mm512_permutexvar_epi32(rotate, vb);
+            match |= _mm512_cmpeq_epi32_mask(va, vb);
+        }
+        count += __builtin_popcount(match);
+        int32_t a_max = a[i + 15];
+        int32_t b_max = b[j + 15];
+        i += (a_max <= b_max) ? 16 : 0;
+        j += (b_max <= a_max) ? 16 : 0;
+    }
+    return count + intersect_count_merge(a + i, na - i, b + j, nb - j);
+}
+#elif defined(__AVX2__)
+inline size_t intersect_count_simd(int32_t const *a, size_t na, int32_t const *b, size_t nb) {
+    size_t i{}, j{}, count{};
+    __m256i const rotate = _mm256_set_epi32(0, 7, 6, 5, 4, 3, 2, 1);
+    while (i + 8 <= na && j + 8 <= nb) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(b + j));
+        __m256i match = _mm256_cmpeq_epi32(va, vb);
+        for (int k = 1; k < 8; ++k) {
+            vb = _mm256_permutevar8x32_epi32(vb, rotate);
+            match = _mm256_or_si256(match, _mm256_cmpeq_epi32(va, vb));
+        }
+        count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(match)));
+        int32_t a_max = a[i + 7];
+        int32_t b_max = b[j + 7];
+        i += (a_max <= b_max) ? 8 : 0;
+        j += (b_max <= a_max) ? 8 : 0;
+    }
+    return count + intersect_count_merge(a + i, na - i, b + j, nb - j);
+}
+#endif
+
+/**
+ * |a ∩ b| for sorted, duplicate-free ranges. Skewed pairs gallop, plain 32-bit ids use the
+ * SIMD all-pairs block compare when the target supports it, everything else merges.
+ */
+template<typename DstT>
+size_t intersect_count(DstT const *a, size_t na, DstT const *b, size_t nb) {
+    if (na > nb) {
+        std::swap(a, b);
+        std::swap(na, nb);
+    }
+    if (na * gallop_ratio < nb) {
+        return intersect_count_gallop(a, na, b, nb);
+    }
+#if defined(__AVX2__) || defined(__AVX512F__)
+    if constexpr (std::is_integral_v<DstT> && sizeof(DstT) == sizeof(int32_t)) {
+        return intersect_count_simd(reinterpret_cast<int32_t const *>(a), na,
+                                    reinterpret_cast<int32_t const *>(b), nb);
+    }
+#endif
+    return intersect_count_merge(a, na, b, nb);
+}
+
+/**
+ * Counts every triangle w < v < u once at its largest id: u only intersects with its
+ * neighbors of smaller id. Ids should be ordered by decreasing degree (reorder_by_degree),
+ * so that the retained neighborhoods are the ones towards the hubs and stay short.
+ */
+template<typename T, typename DstT>
+int64_t count_triangles_ordered(Graph<T, DstT> const &g) {
+    std::vector<size_t> lower_degree(g.get_vertex_number());
+#pragma omp parallel for default(none) shared(g, lower_degree)
+    for (T u = 0; u < g.get_vertex_number(); ++u) {
+        auto neighbors = g.out_neighbors(u);
+        lower_degree[u] = std::lower_bound(neighbors.begin(), neighbors.end(), u,
+            [](DstT const &lhs, T const &rhs) { return get_dst_id(lhs) < rhs; }) - neighbors.begin();
+    }
+    int64_t total{};
+#pragma omp parallel for default(none) shared(g, lower_degree) reduction(+ : total) schedule(dynamic, 64)
+    for (T u = 0; u < g.get_vertex_number(); ++u) {
+        DstT const *nu = g.out_neighbors(u).begin();
+        for (size_t i = 0; i < lower_degree[u]; ++i) {
+            T v = get_dst_id(nu[i]);
+            total += intersect_count(nu, lower_degree[u], g.out_neighbors(v).begin(), lower_degree[v]);
+        }
+    }
+    return total;
+}
+
+/**
+ * Counts every triangle u < v < w once at its smallest id on an upper triangular graph, where
+ * the out-neighborhoods already are the neighbors of larger id. Only the part of u's
+ * neighborhood above v can meet v's.
+ */
+template<typename T, typename DstT>
+int64_t count_triangles_upper(Graph<T, DstT> const &g) {
+    int64_t total{};
+#pragma omp parallel for default(none) shared(g) reduction(+ : total) schedule(dynamic, 64)
+    for (T u = 0; u < g.get_vertex_number(); ++u) {
+        DstT const *nu = g.out_neighbors(u).begin();
+        size_t const degree = g.out_degree(u);
+        for (size_t i = 0; i + 1 < degree; ++i) {
+            T v = get_dst_id(nu[i]);
+            total += intersect_count(nu + i + 1, degree - i - 1, g.out_neighbors(v).begin(), g.out_degree(v));
+        }
+    }
+    return total;
+}
+
+/**
+ * Upper triangular copy of an upper triangular graph with ids by increasing degree, so that
+ * each out-neighborhood only keeps the neighbors of higher degree and hubs keep few edges.
+ * Degrees come from counting both ends of the stored edges, no transpose is built.
+ */
+template<typename T, typename DstT>
+Graph<T, DstT> orient_by_degree(Graph<T, DstT> const &g) {
+    typedef typename Graph<T, DstT>::offset_t offset_t;
+    int64_t vertex_number = g.get_vertex_number();
+    std::vector<offset_t> degrees(vertex_number, 0);
+#pragma omp parallel for default(none) shared(g, degrees, vertex_number)
+    for (T u = 0; u < vertex_number; ++u) {
+        fetch_and_add(degrees[u], g.out_degree(u));
+        for (DstT const &v : g.out_neighbors(u)) {
+            fetch_and_add(degrees[get_dst_id(v)], 1);
+        }
+    }
+    std::vector<T> order(vertex_number);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&degrees](T lhs, T rhs) {
+        return std::tie(degrees[lhs], lhs) < std::tie(degrees[rhs], rhs);
+    });
+    std::vector<T> new_ids(vertex_number);
+#pragma omp parallel for default(none) shared(order, new_ids, vertex_number)
+    for (T i = 0; i < vertex_number; ++i) {
+        new_ids[order[i]] = i;
+    }
+
+    std::fill(degrees.begin(), degrees.end(), 0);
+#pragma omp parallel for default(none) shared(g, degrees, new_ids, vertex_number)
+    for (T u = 0; u < vertex_number; ++u) {
+        for (DstT const &v : g.out_neighbors(u)) {
+            fetch_and_add(degrees[std::min(new_ids[u], new_ids[get_dst_id(v)])], 1);
+        }
+    }
+    offset_t *out_offset = new offset_t[vertex_number + 1];
+    offset_t curr{};
+    for (T u = 0; u < vertex_number; ++u) {
+        out_offset[u] = curr;
+        curr += degrees[u];
+    }
+    out_offset[vertex_number] = curr;
+    DstT *out_neigh = new DstT[curr];
+    std::copy(out_offset, out_offset + vertex_number, degrees.begin());
+#pragma omp parallel for default(none) shared(g, degrees, new_ids, out_neigh, vertex_number)
+    for (T u = 0; u < vertex_number; ++u) {
+        for (DstT const &v : g.out_neighbors(u)) {
+            T a = new_ids[u];
+            T b = new_ids[get_dst_id(v)];
+            DstT w = v;
+            get_dst_id(w) = std::max(a, b);
+            out_neigh[fetch_and_add(degrees[std::min(a, b)], 1)] = w;
+        }
+    }
+#pragma omp parallel for default(none) shared(out_offset, out_neigh, vertex_number) schedule(dynamic, 1024)
+    for (T u = 0; u < vertex_number; ++u) {
+        std::sort(out_neigh + out_offset[u], out_neigh + out_offset[u + 1], [](DstT const &lhs, DstT const &rhs) {
+            return get_dst_id(lhs) < get_dst_id(rhs);
+        });
+    }
+    return Graph<T, DstT>::upper_triangular_graph(vertex_number, out_offset, out_neigh);
+}
+
+template<typename T, typename DstT>
+int64_t count_triangles(Graph<T, DstT> const &g) {
+    if (g.is_upper_triangular()) {
+        return count_triangles_upper(orient_by_degree(g));
+    }
+    auto [ordered, new_ids, new_ids_remap] = reorder_by_degree(g);
+    return count_triangles_ordered(ordered);
+}
+
+/**
+ * |a ∩ b| for two full_neighbors ranges, each the concatenation of two sorted ranges.
+ */
+template<typename Neighborhood>
+size_t intersect_count_full(Neighborhood const &a, Neighborhood const &b) {
+    size_t count{};
+    for (auto [a_begin, a_end] : {std::pair{a.first_begin, a.first_end}, std::pair{a.second_begin, a.second_end}}) {
+        for (auto [b_begin, b_end] : {std::pair{b.first_begin, b.first_end}, std::pair{b.second_begin, b.second_end}}) {
+            if (a_begin != a_end && b_begin != b_end) {
+                count += intersect_count(a_begin, a_end - a_begin, b_begin, b_end - b_begin);
+            }
+        }
+    }
+    return count;
+}
+
+/**
+ * Local clustering coefficient 2 t(v) / (d(v) (d(v) - 1)). Every vertex intersects its full
+ * neighborhood with each neighbor's, which sees each of its triangles twice, so vertices are
+ * independent and need no atomics. Self loops are discounted from degrees and intersections.
+ * Neighborhoods are taken through full_neighbors, so that upper triangular graphs work too.
+ */
+template<typename T, typename DstT>
+std::vector<double> local_clustering(Graph<T, DstT> const &g) {
+    auto has_self_loop = [&g](T v) {
+        auto neighbors = g.out_neighbors(v);
+        return std::binary_search(neighbors.begin(), neighbors.end(), v,
+            [](auto const &lhs, auto const &rhs) { return get_dst_id(lhs) < get_dst_id(rhs); });
+    };
+    if (g.is_upper_triangular()) {
+        // the lower halves, before the parallel loop rather than by its first thread
+        g.build_transpose();
+    }
+    std::vector<double> coefficient(g.get_vertex_number(), 0);
+#pragma omp parallel for default(none) shared(g, coefficient, has_self_loop) schedule(dynamic, 64)
+    for (T v = 0; v < g.get_vertex_number(); ++v) {
+        bool v_loop = has_self_loop(v);
+        int64_t degree = g.full_degree(v) - v_loop;
+        if (degree < 2) {
+            continue;
+        }
+        auto nv = g.full_neighbors(v);
+        int64_t twice_triangles{};
+        for (DstT const &w : nv) {
+            T u = get_dst_id(w);
+            if (u == v) {
+                continue;
+            }
+            twice_triangles += intersect_count_full(nv, g.full_neighbors(u)) - v_loop - has_self_loop(u);
+        }
+        coefficient[v] = static_cast<double>(twice_triangles) / (static_cast<double>(degree) * (degree - 1));
+    }
+    return coefficient;
+}
+
+#endif //EXPERIMENT_TRIANGLE_H
@@ -0,0 +1,178 @@
+#ifndef EXPERIMENT_TUNING_H
+#define EXPERIMENT_TUNING_H
+
+#include "graph.h"
+#include "bfs.h"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <optional>
+#include <chrono>
+#include <random>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+constexpr char const *loop_schedule_names[] = {"static", "dynamic", "guided"};
+constexpr uint64_t tuning_root_seed = 0x6361'6c69'6272'6174;  // calibration roots, apart from benchmark roots
+
+/**
+ * Where the tuning of a graph file is kept: next to it, as <graph file>.tune.
+ */
+inline std::string tuning_path(std::string const &graph_file) {
+    return graph_file + ".tune";
+}
+
+/**
+ * One "key value" line per knob of BfsTuning.
+ */
+inline void save_tuning(std::string const &path, BfsTuning const &tuning) {
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    out << "alpha " << tuning.alpha << '\n'
+        << "beta " << tuning.beta << '\n'
+        << "push_chunk " << tuning.push_chunk << '\n'
+        << "pull_schedule " << loop_schedule_names[static_cast<int>(tuning.pull_schedule)] << '\n'
+        << "pull_chunk " << tuning.pull_chunk << '\n';
+}
+
+/**
+ * std::nullopt if there is no tuning file, it has a line it does not understand or a knob that
+ * is not a positive number (alpha and beta divide, the chunks size loop schedules); knobs
+ * missing from the file keep their defaults.
+ */
+inline std::optional<BfsTuning> load_tuning(std::string const &path) {
+    std::ifstream in(path);
+    if (!in) {
+        return std::nullopt;
+    }
+    BfsTuning tuning;
+    std::string key, value;
+    auto positive = [&value](int &knob) {
+        size_t used = 0;
+        try {
+            knob = std::stoi(value, &used);
+        } catch (std::logic_error const &) {    // invalid_argument or out_of_range
+            return false;
+        }
+        return used == value.size() && knob > 0;
+    };
+    while (in >> key >> value) {
+        if (key == "alpha") {
+            if (!positive(tuning.alpha)) {
+                return std::nullopt;
+            }
+        } else if (key == "beta") {
+            if (!positive(tuning.beta)) {
+                return std::nullopt;
+            }
+        } else if (key == "push_chunk") {
+            if (!positive(tuning.push_chunk)) {
+                return std::nullopt;
+            }
+        } else if (key == "pull_chunk") {
+            if (!positive(tuning.pull_chunk)) {
+                return std::nullopt;
+            }
+        } else if (key == "pull_schedule") {
+            int kind = 0;
+            while (kind < 3 && value != loop_schedule_names[kind]) {
+                kind++;
+            }
+            if (kind == 3) {
+                return std::nullopt;
+            }
+            tuning.pull_schedule = static_cast<LoopSchedule>(kind);
+        } else {
+            return std::nullopt;
+        }
+    }
+    return tuning;
+}
+
+struct NullTuningReport {
+    void operator()(BfsTuning const &, double) const {}
+};
+
+/**
+ * Seconds of the fastest of repeats passes of do_parent_bfs over the roots.
+ */
+template<typename T, typename DstT>
+double time_parent_bfs(Graph<T, DstT> const &graph, std::vector<T> const &roots, BfsTuning const &tuning,
+                       int repeats = 2) {
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < repeats; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        for (T root : roots) {
+            do_parent_bfs(graph, root, tuning);
+        }
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+/**
+ * Per-graph tuning of do_parent_bfs by coordinate descent from the defaults: alpha first, then
+ * beta, then the bottom-up schedule with its chunk, then the top-down chunk, each step keeping
+ * the best value found so far for the other knobs. Every candidate is timed over the same few
+ * calibration roots, drawn from seed among the vertices with edges; keep seed apart from the one
+ * of the measured roots, or the knobs are fitted to the benchmark itself. report sees each
+ * candidate with its time.
+ */
+template<typename T, typename DstT, typename Report = NullTuningReport>
+BfsTuning tune_bfs(Graph<T, DstT> const &graph, int root_num = 8, uint64_t seed = tuning_root_seed,
+                   Report &&report = {}) {
+    std::vector<T> roots;
+    std::mt19937_64 rng{seed};
+    std::uniform_int_distribution<T> dist(0, static_cast<T>(graph.get_vertex_number() - 1));
+    for (int64_t tries = 0; static_cast<int>(roots.size()) < root_num && tries < 64 * graph.get_vertex_number(); ++tries) {
+        T root = dist(rng);
+        if (graph.out_degree(root) > 0) {
+            roots.emplace_back(root);
+        }
+    }
+    BfsTuning best;
+    if (roots.empty()) {
+        return best;
+    }
+    graph.build_transpose();
+    double best_time = time_parent_bfs(graph, roots, best);
+    report(best, best_time);
+    auto consider = [&](BfsTuning const &candidate) {
+        double seconds = time_parent_bfs(graph, roots, candidate);
+        report(candidate, seconds);
+        if (seconds < best_time) {
+            best_time = seconds;
+            best = candidate;
+        }
+    };
+
+    for (int alpha : {1, 2, 4, 8, 15, 30, 60, 120}) {
+        BfsTuning candidate = best;
+        candidate.alpha = alpha;
+        consider(candidate);
+    }
+    for (int beta : {2, 6, 12, 18, 24, 48, 96}) {
+        BfsTuning candidate = best;
+        candidate.beta = beta;
+        consider(candidate);
+    }
+    BfsTuning const switch_tuned = best;
+    for (LoopSchedule schedule : {LoopSchedule::static_chunks, LoopSchedule::dynamic, LoopSchedule::guided}) {
+        for (int chunk : {64, 256, 1024, 4096, 16384}) {
+            BfsTuning candidate = switch_tuned;
+            candidate.pull_schedule = schedule;
+            candidate.pull_chunk = chunk;
+            consider(candidate);
+        }
+    }
+    BfsTuning const pull_tuned = best;
+    for (int chunk : {16, 64, 256, 1024}) {
+        BfsTuning candidate = pull_tuned;
+        candidate.push_chunk = chunk;
+        consider(candidate);
+    }
+    return best;
+}
+
+#endif //EXPERIMENT_TUNING_H
@@ -0,0 +1,66 @@
+#include "graph.h"
+#include "builder.h"
+#include "bfs.h"
+#include "betweenness.h"
+#include "plf_nanotimer.h"
+#include <omp.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+
+namespace fs = std::filesystem;
+
+using Node = int;
+
+int main(int argc, char *argv[]) {
+    omp_set_num_threads(4); // set to an appropriate number according to the CPU cores
+
+    plf::nanotimer timer;
+
+    fs::path graph_file_path(DATASET_PATH);
+    if (argc < 2) {
+        graph_file_path /= "rmat_17.txt";
+    } else {
+        graph_file_path /= argv[1];
+    }
+    // 0 sources means exact betweenness over all vertices
+    int source_num = (argc < 3) ? 4 : std::stoi(argv[2]);
+
+    timer.start();
+    Builder<Node> builder{graph_file_path.string()};
+    Graph<Node> graph = builder.build_csr();
+    std::clog << "Graph: " << graph_file_path.string() << std::endl;
+    std::clog << "Graph Construction: " << timer.get_elapsed_ms() << " ms" << std::endl;
+
+    timer.start();
+    std::vector<Node> sources;
+    if (source_num > 0) {
+        sources = pick_sources(graph, source_num);
+    } else {
+        sources.resize(graph.get_vertex_number());
+        std::iota(sources.begin(), sources.end(), 0);
+    }
+    std::clog << "Source Pick: " << timer.get_elapsed_ms() << " ms" << std::endl;
+
+    timer.start();
+    Betweenness<Node> bc{graph};
+    bc.accumulate(sources);
+    std::vector<double> scores = bc.scores();
+    std::clog << "Processing: " << timer.get_elapsed_ms() << " ms" << std::endl;
+
+    std::ofstream out(graph_file_path.filename().string() + "-betweenness.txt", std::ios::out | std::ios::trunc);
+    out << "# " << graph.get_vertex_number() << " " << graph.get_edge_number() << std::endl;
+    out << "# ";
+    if (source_num > 0) {
+        std::copy(sources.begin(), sources.end(), std::ostream_iterator<int>(out, ", "));
+    } else {
+        out << "all";
+    }
+    out << std::endl;
+    std::copy(scores.begin(), scores.end(), std::ostream_iterator<double>(out, "\n"));
+    out.flush();
+    out.close();
+
+    return 0;
+}
@@ -1,6 +1,8 @@
 #include "graph.h"
 #include "builder.h"
 #include "bfs.h"
+#include "counters.h"
+#include "cache.h"
 #include "plf_nanotimer.h"
 #include <omp.h>
 #include <filesystem>
@@ -13,6 +15,23 @@ namespace fs = std::filesystem;
 using Node = int;
 using Prop = int;
 
+using IterationCounters = std::vector<std::pair<IterStats, CounterValues>>;
+
+void print_counter_report(std::string const &title, std::vector<CounterValues> const &thread_counters,
+                          IterationCounters const &iteration_counters) {
+    CounterValues total{};
+    for (size_t t = 0; t < thread_counters.size(); ++t) {
+        std::cout << title << " Thread " << t << ": " << thread_counters[t] << std::endl;
+        total += thread_counters[t];
+    }
+    std::cout << title << " Total: " << total << std::endl;
+    for (auto const &[stats, values] : iteration_counters) {
+        std::cout << std::format("{} Iter {:<4d} active={} edges={} sim-cachelines={} ", title, stats.iter,
+                                 stats.active_vertices, stats.edges_scanned, stats.cachelines)
+                  << values << std::endl;
+    }
+}
+
 int main(int argc, char *argv[]) {
     omp_set_num_threads(4); // set to an appropriate number according to the CPU cores
 
@@ -31,7 +50,14 @@ int main(int argc, char *argv[]) {
     std::clog << "Graph: " << graph_file_path.string() << std::endl;
     std::clog << "Graph Construction: " << timer.get_elapsed_ms() << " ms" << std::endl;
     timer.start();
-    auto [reordered, new_ids, new_ids_remap] = reorder_by_degree(graph);
+    // loaded from the cache after the first run on this file
+    DerivedGraph<Node> derived = cached_graph<Node>(
+        fs::path(DATASET_PATH)/".cache", graph_file_path.string(), "directed,reorder_by_degree", [&graph] {
+            auto [ordered, new_ids, new_ids_remap] = reorder_by_degree(graph);
+            return DerivedGraph<Node>{std::move(ordered), {std::move(new_ids), std::move(new_ids_remap)}};
+        });
+    Graph<Node> &reordered = derived.graph;
+    std::vector<Node> const &new_ids = derived.id_maps[0];
     std::clog << "Graph Reorder: " << timer.get_elapsed_ms() << " ms" << std::endl;
 
     timer.start();
@@ -47,20 +73,37 @@ int main(int argc, char *argv[]) {
     }
     std::cout << "Non Iso Num: " << non_iso_num << std::endl;
 
+    timer.start();
+    MemoryLayout<unsigned> layout{graph};
+    MemoryLayout<unsigned> reordered_layout{reordered};
+    std::clog << "Memory Layout: " << timer.get_elapsed_ms() << " ms" << std::endl;
+
     timer.start();
     long double edge_visit{};
     long double edge_visit_cacheline{};
-    #pragma omp parallel default(none) shared(graph, sources, edge_visit, edge_visit_cacheline)
+    std::vector<CounterValues> thread_counters(omp_get_max_threads());    // by omp_get_thread_num()
+    IterationCounters iteration_counters;
+    #pragma omp parallel default(none) shared(graph, layout, sources, edge_visit, edge_visit_cacheline, thread_counters, iteration_counters)
     {
         long double l_edge_visit{};
         long double l_edge_visit_cacheline{};
-        Memory<unsigned> memory{graph};
+        Memory<unsigned> memory{layout};
+        PerfCounters counters;
+        PerfIterationLog log{counters};
+        counters.start();
         #pragma omp for nowait
         for (size_t i = 0; i < sources.size(); ++i) {
-            auto [t_visit, t_visit_cacheline] = do_cacheline_bfs(graph, sources[i], memory);
+            log.mark();
+            auto [t_visit, t_visit_cacheline] = do_cacheline_bfs(graph, sources[i], memory, log);
             l_edge_visit += t_visit;
             l_edge_visit_cacheline += t_visit_cacheline;
         }
+        counters.stop();
+        thread_counters[omp_get_thread_num()] = counters.read();
+        #pragma omp critical
+        {
+            merge_iteration_records(iteration_counters, log.records);
+        }
         #pragma omp atomic
         edge_visit = edge_visit + l_edge_visit;
         #pragma omp atomic
@@ -71,17 +114,29 @@ int main(int argc, char *argv[]) {
     timer.start();
     long double reorder_edge_visit{};
     long double reorder_edge_visit_cacheline{};
-    #pragma omp parallel default(none) shared(reordered, new_ids, sources, reorder_edge_visit, reorder_edge_visit_cacheline)
+    std::vector<CounterValues> reorder_thread_counters(omp_get_max_threads());    // by omp_get_thread_num()
+    IterationCounters reorder_iteration_counters;
+    #pragma omp parallel default(none) shared(reordered, reordered_layout, new_ids, sources, reorder_edge_visit, reorder_edge_visit_cacheline, reorder_thread_counters, reorder_iteration_counters)
     {
         long double l_edge_visit{};
         long double l_edge_visit_cacheline{};
-        Memory<unsigned> memory{reordered};
+        Memory<unsigned> memory{reordered_layout};
+        PerfCounters counters;
+        PerfIterationLog log{counters};
+        counters.start();
         #pragma omp for nowait
         for (size_t i = 0; i < sources.size(); ++i) {
-            auto [t_visit, t_visit_cacheline] = do_cacheline_bfs(reordered, new_ids[sources[i]], memory);
+            log.mark();
+            auto [t_visit, t_visit_cacheline] = do_cacheline_bfs(reordered, new_ids[sources[i]], memory, log);
             l_edge_visit += t_visit;
             l_edge_visit_cacheline += t_visit_cacheline;
         }
+        counters.stop();
+        reorder_thread_counters[omp_get_thread_num()] = counters.read();
+        #pragma omp critical
+        {
+            merge_iteration_records(reorder_iteration_counters, log.records);
+        }
         #pragma omp atomic
         reorder_edge_visit = reorder_edge_visit + l_edge_visit;
         #pragma omp atomic
@@ -98,4 +153,7 @@ int main(int argc, char *argv[]) {
     std::cout << std::format("Reorder Non-Iso-Vertex-Avg Edge Visit: {:.2f}", reorder_edge_visit / sources.size() / non_iso_num) << std::endl;
     std::cout << std::format("Reorder Vertex-Avg Edge Visit Cacheline: {:.2f}", reorder_edge_visit_cacheline / sources.size() / graph.get_vertex_number()) << std::endl;
     std::cout << std::format("Reorder Non-Iso-Vertex-Avg Edge Visit Cacheline: {:.2f}", reorder_edge_visit_cacheline / sources.size() / non_iso_num) << std::endl;
+
+    print_counter_report("Original", thread_counters, iteration_counters);
+    print_counter_report("Reorder", reorder_thread_counters, reorder_iteration_counters);
 }
\ No newline at end of file
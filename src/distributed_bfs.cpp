@@ -0,0 +1,108 @@
+#include "graph.h"
+#include "builder.h"
+#include "bfs.h"
+#include "distributed_bfs.h"
+#include <mpi.h>
+#include <omp.h>
+#include <filesystem>
+#include <iostream>
+#include <iomanip>
+#include <optional>
+#include <string>
+
+namespace fs = std::filesystem;
+
+using Node = int;
+using Prop = int;
+
+/**
+ * Per-rank totals over all sources, gathered on rank 0 for the report.
+ */
+struct RankReport {
+    double compute_seconds;
+    double comm_seconds;
+    double bytes_sent;
+    double bytes_received;
+    double sparse_messages;
+    double bitmap_messages;
+};
+
+int main(int argc, char *argv[]) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    fs::path graph_file_path(DATASET_PATH);
+    if (argc < 2) {
+        graph_file_path /= "rmat_17.txt";
+    } else {
+        graph_file_path /= argv[1];
+    }
+    int source_num = (argc < 3) ? 8 : std::stoi(argv[2]);
+    // "verify" checks the depths against do_bfs on rank 0, which then loads the whole graph
+    bool verify = argc > 3 && std::string(argv[3]) == "verify";
+
+    // every rank reads its share of the file and receives the in-edges of its vertices
+    double start = MPI_Wtime();
+    std::vector<Node> bounds;
+    LocalGraph<Node> local = load_local_graph<Node>(graph_file_path.string(), bounds);
+    std::vector<Node> sources = pick_distributed_sources(local, source_num);
+    if (rank == 0) {
+        std::clog << "Graph: " << graph_file_path.string() << std::endl;
+        std::clog << "Graph Partition: " << (MPI_Wtime() - start) * 1e3 << " ms over " << ranks << " ranks" << std::endl;
+    }
+    std::optional<Graph<Node>> graph;
+    if (verify && rank == 0) {
+        graph.emplace(Builder<Node>{graph_file_path.string()}.build_csr());
+    }
+
+    CommStats comm;
+    double compute_seconds{};
+    bool pass = true;
+    for (Node root : sources) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        start = MPI_Wtime();
+        double comm_before = comm.seconds;
+        std::vector<Prop> depth = do_distributed_bfs(local, bounds, root, comm);
+        compute_seconds += MPI_Wtime() - start - (comm.seconds - comm_before);
+        if (!verify) {
+            continue;
+        }
+
+        std::vector<int> counts(ranks), displs(ranks);
+        for (int r = 0; r < ranks; ++r) {
+            counts[r] = bounds[r + 1] - bounds[r];
+            displs[r] = bounds[r];
+        }
+        std::vector<Prop> all_depth(rank == 0 ? graph->get_vertex_number() : 0);
+        MPI_Gatherv(depth.data(), static_cast<int>(depth.size()), MPI_INT,
+                    all_depth.data(), counts.data(), displs.data(), MPI_INT, 0, MPI_COMM_WORLD);
+        if (rank == 0) {
+            pass = pass && (all_depth == do_bfs(*graph, root));
+        }
+    }
+
+    RankReport report{compute_seconds, comm.seconds, static_cast<double>(comm.bytes_sent),
+                      static_cast<double>(comm.bytes_received), static_cast<double>(comm.sparse_messages),
+                      static_cast<double>(comm.bitmap_messages)};
+    std::vector<RankReport> reports(ranks);
+    MPI_Gather(&report, sizeof(RankReport), MPI_BYTE, reports.data(), sizeof(RankReport), MPI_BYTE, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        std::cout << "rank  vertices   compute_ms    comm_ms    sent_MB    recv_MB  sparse  bitmap" << std::endl;
+        for (int r = 0; r < ranks; ++r) {
+            auto const &rr = reports[r];
+            std::cout << std::setw(4) << r << std::setw(10) << bounds[r + 1] - bounds[r] << std::fixed
+                      << std::setprecision(2) << std::setw(13) << rr.compute_seconds * 1e3
+                      << std::setw(11) << rr.comm_seconds * 1e3
+                      << std::setw(11) << rr.bytes_sent / 1e6 << std::setw(11) << rr.bytes_received / 1e6
+                      << std::setprecision(0) << std::setw(8) << rr.sparse_messages
+                      << std::setw(8) << rr.bitmap_messages << std::endl;
+        }
+        std::cout << "Verification: " << (!verify ? "skipped" : pass ? "PASS" : "FAIL") << std::endl;
+    }
+
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "graph.h"
+#include "builder.h"
+#include "generator.h"
+#include "edge_stream.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <charconv>
+#include <chrono>
+#include <string>
+
+namespace fs = std::filesystem;
+
+using Node = int;
+
+/**
+ * Text edge list in the format of the rmat_xx.txt datasets.
+ */
+void write_text_edges(std::string const &path, Builder<Node>::EdgeList const &el) {
+    std::ofstream out(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    std::vector<char> buf(edge_block_size);
+    char *pos = buf.data();
+    for (auto const &[u, v] : el) {
+        if (buf.data() + buf.size() - pos < 64) {
+            out.write(buf.data(), pos - buf.data());
+            pos = buf.data();
+        }
+        pos = std::to_chars(pos, buf.data() + buf.size(), u).ptr;
+        *pos++ = ' ';
+        pos = std::to_chars(pos, buf.data() + buf.size(), v).ptr;
+        *pos++ = '\n';
+    }
+    out.write(buf.data(), pos - buf.data());
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " scale [edge_factor] [output] [a b c] [seed]" << std::endl;
+        return 1;
+    }
+    RmatParams params;
+    params.scale = std::stoi(argv[1]);
+    if (argc > 2) {
+        params.edge_factor = std::stoi(argv[2]);
+    }
+    // .bel writes the binary edge list Builder loads without parsing, anything else is text
+    fs::path output(DATASET_PATH);
+    output /= (argc > 3) ? std::string(argv[3]) : "rmat_" + std::to_string(params.scale) + ".bel";
+    if (argc > 6) {
+        params.a = std::stod(argv[4]);
+        params.b = std::stod(argv[5]);
+        params.c = std::stod(argv[6]);
+    }
+    if (argc > 7) {
+        params.seed = std::stoull(argv[7]);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto el = generate_rmat<Node>(params);
+    auto mid = std::chrono::steady_clock::now();
+    if (has_extension(output.string(), ".bel")) {
+        write_binary_edges(output.string(), el, int64_t{1} << params.scale);
+    } else {
+        write_text_edges(output.string(), el);
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::clog << "Generation: " << std::chrono::duration<double, std::milli>(mid - start).count() << " ms, "
+              << el.size() << " edges" << std::endl;
+    std::clog << "Write: " << std::chrono::duration<double, std::milli>(end - mid).count() << " ms to "
+              << output.string() << std::endl;
+    return 0;
+}
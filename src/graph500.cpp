@@ -0,0 +1,239 @@
+#include "graph.h"
+#include "builder.h"
+#include "bfs.h"
+#include "generator.h"
+#include "tuning.h"
+#include <filesystem>
+#include <iostream>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cctype>
+#include <string>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+using Node = int;
+
+constexpr int graph500_roots = 64;
+
+/**
+ * Graph500 validation of a BFS tree: parent[root] is root, following parents from any reached
+ * vertex ends at the root (levels are recomputed from the tree alone, so a cycle leaves
+ * vertices without one), every tree edge is a graph edge, every graph edge between reached
+ * vertices spans at most one level, and no edge leads from a reached vertex to an unreached one.
+ */
+bool validate_bfs_tree(Graph<Node> const &graph, Node root, std::vector<Node> const &parent) {
+    int64_t const vertex_number = graph.get_vertex_number();
+    if (parent[root] != root) {
+        return false;
+    }
+    // pointer jumping: after round k, ancestor[v] is the 2^k-th ancestor of v (stopping at the
+    // root) and distance[v] the number of tree edges to it. Rounds read one pair of arrays and
+    // write the other, and a path of any depth collapses in log2(depth) rounds.
+    std::vector<Node> ancestor(vertex_number, -1), next_ancestor(vertex_number);
+    std::vector<int64_t> distance(vertex_number, 0), next_distance(vertex_number);
+    bool valid = true;
+#pragma omp parallel for default(shared) reduction(&& : valid)
+    for (Node v = 0; v < vertex_number; ++v) {
+        if (is_max_prop(parent[v])) {
+            continue;
+        }
+        if (parent[v] < 0 || parent[v] >= vertex_number) {
+            valid = false;
+        } else if (v != root) {
+            ancestor[v] = parent[v];
+            distance[v] = 1;
+        }
+    }
+    ancestor[root] = root;
+    bool changed = true;
+    for (int64_t span = 1; changed && span < vertex_number; span *= 2) {
+        changed = false;
+#pragma omp parallel for default(shared) reduction(|| : changed)
+        for (Node v = 0; v < vertex_number; ++v) {
+            Node a = ancestor[v];
+            if (a == -1 || a == root) {
+                next_ancestor[v] = a;
+                next_distance[v] = distance[v];
+            } else {
+                // a chain through an unreached vertex or a cycle never ends at the root
+                next_ancestor[v] = ancestor[a];
+                next_distance[v] = distance[v] + distance[a];
+                changed = true;
+            }
+        }
+        ancestor.swap(next_ancestor);
+        distance.swap(next_distance);
+    }
+    std::vector<int> level(vertex_number, -1);
+#pragma omp parallel for default(shared)
+    for (Node v = 0; v < vertex_number; ++v) {
+        if (ancestor[v] == root) {
+            level[v] = static_cast<int>(distance[v]);
+        }
+    }
+    bool const directed = graph.is_directed();
+    auto less = [](Node const &lhs, Node const &rhs) { return get_dst_id(lhs) < get_dst_id(rhs); };
+#pragma omp parallel for default(shared) schedule(dynamic, 1024) reduction(&& : valid)
+    for (Node v = 0; v < vertex_number; ++v) {
+        if (is_max_prop(parent[v])) {
+            continue;
+        }
+        if (level[v] == -1) {
+            valid = false;  // on a cycle, or below one
+            continue;
+        }
+        if (v != root) {
+            auto neighbors = graph.out_neighbors(parent[v]);
+            valid = valid && std::binary_search(neighbors.begin(), neighbors.end(), v, less);
+        }
+        for (auto const &w : graph.out_neighbors(v)) {
+            Node u = get_dst_id(w);
+            if (level[u] == -1) {
+                valid = false;
+            } else if (directed ? level[u] > level[v] + 1 : std::abs(level[u] - level[v]) > 1) {
+                valid = false;
+            }
+        }
+    }
+    return valid;
+}
+
+/**
+ * Edges of the traversed component, which Graph500 divides by the BFS time; an undirected
+ * edge is stored at both ends.
+ */
+int64_t traversed_edges(Graph<Node> const &graph, std::vector<Node> const &parent) {
+    int64_t edges{};
+#pragma omp parallel for default(shared) reduction(+ : edges)
+    for (Node v = 0; v < graph.get_vertex_number(); ++v) {
+        if (!is_max_prop(parent[v])) {
+            edges += graph.out_degree(v);
+        }
+    }
+    return graph.is_directed() ? edges : edges / 2;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " scale|graph_file [edge_factor] [roots] [tune]" << std::endl;
+        return 1;
+    }
+    std::string input(argv[1]);
+    bool generate = std::all_of(input.begin(), input.end(), [](char c) { return std::isdigit(c); });
+    RmatParams params;
+    if (argc > 2) {
+        params.edge_factor = std::stoi(argv[2]);
+    }
+    int root_num = (argc > 3) ? std::stoi(argv[3]) : graph500_roots;
+    bool tune = argc > 4 && std::string(argv[4]) == "tune";
+
+    // Graph500 graphs are undirected: Kronecker edges or the file's edges in both directions
+    auto start = std::chrono::steady_clock::now();
+    Graph<Node> graph;
+    fs::path graph_file_path(DATASET_PATH);
+    if (generate) {
+        params.scale = std::stoi(input);
+        graph = Builder<Node>{true}.build_csr(generate_rmat<Node>(params), int64_t{1} << params.scale);
+        graph_file_path /= "kronecker_" + input + "_" + std::to_string(params.edge_factor);
+    } else {
+        graph_file_path /= input;
+        graph = Builder<Node>{graph_file_path.string(), true}.build_csr();
+    }
+    double construction_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // "tune" searches the BFS knobs on this graph and saves them, later runs load them. The
+    // calibration roots come from their own seed, not from the benchmark roots below
+    std::string tuning_file = tuning_path(graph_file_path.string());
+    BfsTuning tuning;
+    if (tune) {
+        tuning = tune_bfs(graph, 8, tuning_root_seed, [](BfsTuning const &t, double seconds) {
+            std::clog << "alpha " << t.alpha << " beta " << t.beta << " push_chunk " << t.push_chunk
+                      << " pull " << loop_schedule_names[static_cast<int>(t.pull_schedule)] << "," << t.pull_chunk
+                      << ": " << seconds * 1e3 << " ms" << std::endl;
+        });
+        save_tuning(tuning_file, tuning);
+        std::clog << "Tuning saved to " << tuning_file << std::endl;
+    } else if (auto loaded = load_tuning(tuning_file)) {
+        tuning = *loaded;
+        std::clog << "Tuning loaded from " << tuning_file << std::endl;
+    }
+
+    // distinct roots with at least one edge, from a fixed seed so that runs are comparable
+    std::vector<Node> roots;
+    std::unordered_set<Node> picked;
+    std::mt19937_64 rng{params.seed};
+    std::uniform_int_distribution<Node> dist(0, static_cast<Node>(graph.get_vertex_number() - 1));
+    for (int64_t tries = 0; static_cast<int>(roots.size()) < root_num && tries < 64 * graph.get_vertex_number(); ++tries) {
+        Node root = dist(rng);
+        if (graph.out_degree(root) > 0 && picked.insert(root).second) {
+            roots.emplace_back(root);
+        }
+    }
+
+    if (roots.empty()) {
+        std::cerr << "no vertex with edges to start from" << std::endl;
+        return 1;
+    }
+
+    std::vector<double> times, teps;
+    double validation_time{};
+    bool pass = true;
+    for (Node root : roots) {
+        start = std::chrono::steady_clock::now();
+        std::vector<Node> parent = do_parent_bfs(graph, root, tuning);
+        auto mid = std::chrono::steady_clock::now();
+        pass = validate_bfs_tree(graph, root, parent) && pass;
+        validation_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - mid).count();
+        double seconds = std::chrono::duration<double>(mid - start).count();
+        times.emplace_back(seconds);
+        teps.emplace_back(static_cast<double>(traversed_edges(graph, parent)) / seconds);
+    }
+
+    auto quantile = [](std::vector<double> values, double q) {
+        std::sort(values.begin(), values.end());
+        return values[static_cast<size_t>(q * (values.size() - 1))];
+    };
+    double n = static_cast<double>(teps.size());
+    double inverse_sum{};
+    for (double x : teps) {
+        inverse_sum += 1 / x;
+    }
+    double harmonic_mean = n / inverse_sum;
+    double deviation{};
+    for (double x : teps) {
+        deviation += (1 / x - 1 / harmonic_mean) * (1 / x - 1 / harmonic_mean);
+    }
+    double harmonic_stddev = (n > 1) ? std::sqrt(deviation) / (n - 1) * harmonic_mean * harmonic_mean : 0;
+
+    if (generate) {
+        std::cout << "SCALE: " << params.scale << std::endl;
+        std::cout << "edgefactor: " << params.edge_factor << std::endl;
+    } else {
+        std::cout << "graph: " << input << std::endl;
+    }
+    std::cout << "NBFS: " << roots.size() << std::endl;
+    std::cout << "num_vertices: " << graph.get_vertex_number() << std::endl;
+    std::cout << "num_edges: " << graph.get_edge_number() << std::endl;
+    std::cout << "construction_time: " << construction_time << std::endl;
+    std::cout << "bfs_tuning: alpha " << tuning.alpha << " beta " << tuning.beta << " push_chunk " << tuning.push_chunk
+              << " pull_schedule " << loop_schedule_names[static_cast<int>(tuning.pull_schedule)]
+              << " pull_chunk " << tuning.pull_chunk << std::endl;
+    std::cout << "bfs_min_time: " << quantile(times, 0) << std::endl;
+    std::cout << "bfs_median_time: " << quantile(times, 0.5) << std::endl;
+    std::cout << "bfs_max_time: " << quantile(times, 1) << std::endl;
+    std::cout << "validation_time: " << validation_time << std::endl;
+    std::cout << "min_TEPS: " << quantile(teps, 0) << std::endl;
+    std::cout << "firstquartile_TEPS: " << quantile(teps, 0.25) << std::endl;
+    std::cout << "median_TEPS: " << quantile(teps, 0.5) << std::endl;
+    std::cout << "thirdquartile_TEPS: " << quantile(teps, 0.75) << std::endl;
+    std::cout << "max_TEPS: " << quantile(teps, 1) << std::endl;
+    std::cout << "harmonic_mean_TEPS: " << harmonic_mean << std::endl;
+    std::cout << "harmonic_stddev_TEPS: " << harmonic_stddev << std::endl;
+    std::cout << "Verification: " << (pass ? "PASS" : "FAIL") << std::endl;
+    return pass ? 0 : 2;
+}
@@ -2,31 +2,43 @@
 #include "builder.h"
 #include "bfs.h"
 #include "bitmap.h"
+#include "incremental_bfs.h"
+#include "components.h"
+#include "triangle.h"
+#include "pagerank.h"
+#include "timeline.h"
+#include "segment.h"
+#include "generator.h"
+#include "memory.h"
+#include "bidirectional.h"
+#include "partition.h"
+#include "cache.h"
 #include <filesystem>
+#include <fstream>
 #include <format>
 #include <iterator>
+#include <ranges>
+#include <chrono>
+#include <optional>
 
 namespace fs = std::filesystem;
 
 using Node = int;
 using Prop = int;
 
-template<typename T, typename U, typename V>
-std::ostream &print_info(std::ostream &out, T const &iter, U const &active_vertex, V const &active_edge) {
-    out << std::format("{} {:<10d} {:<15d}", iter, active_vertex, active_edge) << std::endl;
-    return out;
-}
-
-template<typename T, typename DstT, typename PropT = int>
-std::vector<PropT> push_active_num_ana(Graph<T, DstT> const &graph, T root) {
+template<typename T, typename DstT, typename PropT = int, typename Observer = NullIterObserver>
+std::vector<PropT> push_active_num_ana(Graph<T, DstT> const &graph, T root, Observer &&observer = {}) {
     std::vector<PropT> depth(graph.get_vertex_number(), get_max_prop<PropT>());
     std::queue<T> frontier;
     depth[root] = 0;
     frontier.emplace(root);
     int iter{};
-    print_info(std::cout, iter, frontier.size(), graph.out_degree(root));
+    // frontier size if vertices discovered several times were pushed every time
+    long long frontier_vertices = 1;
+    long long frontier_edges = graph.out_degree(root);
     while (!frontier.empty()) {
         int frontier_size = frontier.size();
+        IterStats stats{iter, Direction::push, frontier_vertices, frontier_edges, frontier_size};
         long long active_num{};
         long long total_degree{};
         std::vector<int> frontier_vec;
@@ -38,13 +50,17 @@ std::vector<PropT> push_active_num_ana(Graph<T, DstT> const &graph, T root) {
         // dry run
         for (auto const &u : frontier_vec) {
             for (auto const &v : graph.out_neighbors(u)) {
+                stats.edges_scanned++;
                 if (is_max_prop(depth[v])) {
                     active_num += 1;
                     total_degree += graph.out_degree(v);
                 }
             }
         }
-        print_info(std::cout, iter + 1, active_num, total_degree);
+        stats.discovered = active_num;
+        observer(stats);
+        frontier_vertices = active_num;
+        frontier_edges = total_degree;
         for (auto const &u : frontier_vec) {
             for (auto const &v : graph.out_neighbors(u)) {
                 if (is_max_prop(depth[v])) {
@@ -58,21 +74,23 @@ std::vector<PropT> push_active_num_ana(Graph<T, DstT> const &graph, T root) {
     return depth;
 }
 
-template<typename T, typename DstT, typename PropT = int>
-std::vector<PropT> push_active_num_no_repeat_ana(Graph<T, DstT> const &graph, T root) {
+template<typename T, typename DstT, typename PropT = int, typename Observer = NullIterObserver>
+std::vector<PropT> push_active_num_no_repeat_ana(Graph<T, DstT> const &graph, T root, Observer &&observer = {}) {
     std::vector<PropT> depth(graph.get_vertex_number(), get_max_prop<PropT>());
     std::queue<T> frontier;
     depth[root] = 0;
     frontier.emplace(root);
     int iter{};
-    print_info(std::cout, iter, frontier.size(), graph.out_degree(root));
+    long long frontier_edges = graph.out_degree(root);
     while (!frontier.empty()) {
         int frontier_size = frontier.size();
+        IterStats stats{iter, Direction::push, frontier_size, frontier_edges, frontier_size};
         long long active_num{};
         long long total_degree{};
         while (frontier_size-- > 0) {
             T u = frontier.front(); frontier.pop();
             for (auto const &v : graph.out_neighbors(u)) {
+                stats.edges_scanned++;
                 if (is_max_prop(depth[v])) {
                     active_num += 1;
                     total_degree += graph.out_degree(v);
@@ -81,7 +99,9 @@ std::vector<PropT> push_active_num_no_repeat_ana(Graph<T, DstT> const &graph, T
                 }
             }
         }
-        print_info(std::cout, iter + 1, active_num, total_degree);
+        stats.discovered = active_num;
+        observer(stats);
+        frontier_edges = total_degree;
         iter++;
     }
     return depth;
@@ -102,8 +122,8 @@ auto pull_active_helper(Graph<T, DstT> const &graph, std::vector<PropT> const &d
     return {active_num, total_degree};
 }
 
-template<typename T, typename DstT, typename PropT = int>
-std::vector<PropT> pull_active_num_ana(Graph<T, DstT> const &graph, T root) {
+template<typename T, typename DstT, typename PropT = int, typename Observer = NullIterObserver>
+std::vector<PropT> pull_active_num_ana(Graph<T, DstT> const &graph, T root, Observer &&observer = {}) {
     std::vector<PropT> depth(graph.get_vertex_number(), get_max_prop<PropT>());
     depth[root] = 0;
     Bitmap front(graph.get_vertex_number());
@@ -114,10 +134,11 @@ std::vector<PropT> pull_active_num_ana(Graph<T, DstT> const &graph, T root) {
     depth[root] = 0;
     int sum = 1;
     int iter{};
+    long long frontier_edges = graph.out_degree(root);
     while (sum > 0) {
+        IterStats stats{iter, Direction::pull, sum, frontier_edges};
         sum = 0;
-//        auto [active_num, total_degree] = pull_active_helper(graph, depth);
-//        print_info(std::cout, iter + 1, active_num, total_degree);
+        frontier_edges = 0;
         long long active_v{};
         long long edge_visit{};
         for (T v : std::views::iota(0, graph.get_vertex_number())) {
@@ -128,20 +149,24 @@ std::vector<PropT> pull_active_num_ana(Graph<T, DstT> const &graph, T root) {
                     if (front.get_bit(u)) {
                         depth[v] = depth[u] + 1;
                         sum++;
+                        frontier_edges += graph.out_degree(v);
                         next.set_bit(v);
                     }
                 }
             }
         }
-        print_info(std::cout, iter, active_v, edge_visit);
+        stats.active_vertices = active_v;
+        stats.edges_scanned = edge_visit;
+        stats.discovered = sum;
+        observer(stats);
         iter++;
         front.swap(next);
     }
     return depth;
 }
 
-template<typename T, typename DstT, typename PropT = int>
-std::vector<PropT> pull_eb_active_num_ana(Graph<T, DstT> const &graph, T root) {
+template<typename T, typename DstT, typename PropT = int, typename Observer = NullIterObserver>
+std::vector<PropT> pull_eb_active_num_ana(Graph<T, DstT> const &graph, T root, Observer &&observer = {}) {
     std::vector<PropT> depth(graph.get_vertex_number(), get_max_prop<PropT>());
     depth[root] = 0;
     Bitmap front(graph.get_vertex_number());
@@ -152,10 +177,11 @@ std::vector<PropT> pull_eb_active_num_ana(Graph<T, DstT> const &graph, T root) {
     depth[root] = 0;
     int sum = 1;
     int iter{};
+    long long frontier_edges = graph.out_degree(root);
     while (sum > 0) {
+        IterStats stats{iter, Direction::pull, sum, frontier_edges};
         sum = 0;
-//        auto [active_num, total_degree] = pull_active_helper(graph, depth);
-//        print_info(std::cout, iter + 1, active_num, total_degree);
+        frontier_edges = 0;
         long long active_v{};
         long long edge_visit{};
         for (T v : std::views::iota(0, graph.get_vertex_number())) {
@@ -166,13 +192,17 @@ std::vector<PropT> pull_eb_active_num_ana(Graph<T, DstT> const &graph, T root) {
                     if (front.get_bit(u)) {
                         depth[v] = depth[u] + 1;
                         sum++;
+                        frontier_edges += graph.out_degree(v);
                         next.set_bit(v);
                         break;
                     }
                 }
             }
         }
-        print_info(std::cout, iter, active_v, edge_visit);
+        stats.active_vertices = active_v;
+        stats.edges_scanned = edge_visit;
+        stats.discovered = sum;
+        observer(stats);
         iter++;
         front.swap(next);
     }
@@ -233,35 +263,28 @@ int main(int argc, char *argv[]) {
 
     for (auto const &graph_name : graph_names) {
         bool need_sym = (std::find(undirected_graph_names.begin(), undirected_graph_names.end(), graph_name) != undirected_graph_names.end());
-        Builder<Node> builder{(dataset_path/(graph_name+".txt")).string(), need_sym};
-        Graph<Node> graph;
-        {
-            Graph<Node> raw = builder.build_csr();
-            auto [g1, new_ids, new_ids_remap] = squeeze_graph(raw);
-            graph = simplify_graph(g1);
-        }
-        std::clog << "Graph: " << (dataset_path/(graph_name+".txt")).string() << std::endl;
-        graph.sort_neighborhood(std::greater<>());
-
-        std::vector<Node> sources = pick_sources(graph, 16);
+        std::string graph_file = (dataset_path/(graph_name+".txt")).string();
+        // id_maps are the vertex_map and vertex_remap of squeeze_graph
+        auto [graph, id_maps] = cached_graph<Node>(
+            dataset_path/".cache", graph_file,
+            need_sym ? "symmetric,squeeze,simplify,sort_by_degree_desc" : "squeeze,simplify,sort_by_degree_desc", [&] {
+                Graph<Node> raw = Builder<Node>{graph_file, need_sym}.build_csr();
+                auto [g1, vertex_map, vertex_remap] = squeeze_graph(raw);
+                Graph<Node> simple = simplify_graph(g1);
+                simple.sort_neighborhood(std::greater<>());
+                return DerivedGraph<Node>{std::move(simple), {std::move(vertex_map), std::move(vertex_remap)}};
+            });
+        std::clog << "Graph: " << graph_file << std::endl;
+
+        std::vector<Node> comp = afforest(graph);
+        std::vector<int64_t> comp_sizes = component_sizes(comp);
+        Node giant = largest_component<Node>(comp_sizes);
+        std::clog << "Giant Component: " << comp_sizes[giant] << " / " << graph.get_vertex_number() << std::endl;
+
+        std::vector<Node> sources = pick_sources(graph, 16, comp, giant);
         std::copy(sources.begin(), sources.end(), std::ostream_iterator<Node>(std::cout, ","));
         std::cout << std::endl;
 
-//        std::random_device rd;
-//        std::mt19937 rng(rd());
-//        std::uniform_int_distribution<Node> dist(0, static_cast<Node>(graph.get_vertex_number() - 1));
-//
-//        std::vector<int> sources; sources.reserve(64);
-//        for (int i{}; i < 64; ++i) {
-//            Node rn;
-//            do {
-//                rn = dist(rng);
-//            } while (graph.out_degree(rn) == 0);
-//            std::vector<Prop> depth = do_bfs(graph, rn);
-//            int tree_size = std::transform_reduce(depth.begin(), depth.end(), 0, std::plus<>(), [](Prop const &p) -> int { return p >= 0; });
-//            std::cout << tree_size << " " << rn << std::endl;
-//        }
-
         fs::path output_path(OUTPUT_PATH);
         std::ofstream out((output_path/("sorted-tmp-"+graph_name+".txt")).string(), std::ios::out | std::ios::trunc);
         out << graph.get_vertex_number() << " "
@@ -365,14 +388,22 @@ int _1main(int argc, char *argv[]) {
     Node root = sources[0];
     std::clog << "Root: " << root << std::endl;
 
+    Timeline timeline;
     std::cout << "Push重复" << std::endl;
-    std::vector<int> depth_1 = push_active_num_ana(graph, root);
+    std::vector<int> depth_1 = push_active_num_ana(graph, root, timeline);
+    timeline.dump_csv(std::cout);
+    timeline.clear();
     std::cout << "\nPush不重复" << std::endl;
-    std::vector<int> depth_2 = push_active_num_no_repeat_ana(graph, root);
+    std::vector<int> depth_2 = push_active_num_no_repeat_ana(graph, root, timeline);
+    timeline.dump_csv(std::cout);
+    timeline.clear();
     std::cout << "\nPull" << std::endl;
-    std::vector<int> depth_3 = pull_active_num_ana(graph, root);
+    std::vector<int> depth_3 = pull_active_num_ana(graph, root, timeline);
+    timeline.dump_csv(std::cout);
+    timeline.clear();
     std::cout << "\nPull Early Break" << std::endl;
-    std::vector<int> depth_4 = pull_eb_active_num_ana(graph, root);
+    std::vector<int> depth_4 = pull_eb_active_num_ana(graph, root, timeline);
+    timeline.dump_csv(std::cout);
     std::cout << std::endl;
 
     bool pass = true;
@@ -390,3 +421,433 @@ int _1main(int argc, char *argv[]) {
 
     return 0;
 }
+
+
+int _5main(int argc, char *argv[]) {
+    fs::path graph_file_path(DATASET_PATH);
+    graph_file_path /= (argc < 2) ? "rmat_20.txt" : argv[1];
+    int batch_size = (argc < 3) ? 64 : std::stoi(argv[2]);
+
+    // 0->1->2->3 and 0->4->5->6->2: deleting (0, 1) first invalidates 1 before (1, 2) is seen,
+    // which must still invalidate 2 and 3; no fallback to do_bfs with a limit of 1
+    {
+        Graph<Node> chain = Builder<Node>{}.build_csr({{0, 1}, {1, 2}, {2, 3}, {0, 4}, {4, 5}, {5, 6}, {6, 2}});
+        bool pass = true;
+        for (EdgeBatch<Node> batch : {EdgeBatch<Node>{{0, 1}, {1, 2}}, EdgeBatch<Node>{{1, 2}, {0, 1}}}) {
+            std::vector<Prop> chain_depth = do_bfs(chain, 0);
+            Graph<Node> chain_updated = apply_edge_updates(chain, {}, batch);
+            repair_bfs(chain_updated, 0, chain_depth, {}, batch, 1.0);
+            pass = pass && chain_depth == do_bfs(chain_updated, 0);
+        }
+        std::cout << "Batch Order: " << (pass ? "PASS" : "FAIL") << std::endl;
+    }
+
+    Builder<Node> builder{graph_file_path.string()};
+    Graph<Node> graph = builder.build_csr();
+    std::clog << "Graph: " << graph_file_path.string() << std::endl;
+
+    Node root = pick_sources(graph, 1)[0];
+    std::vector<Prop> depth = do_bfs(graph, root);
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<Node> dist(0, static_cast<Node>(graph.get_vertex_number() - 1));
+    EdgeBatch<Node> inserted, deleted;
+    while (deleted.size() < batch_size) {
+        Node u = dist(rng);
+        if (graph.out_degree(u) > 0) {
+            deleted.emplace_back(u, *graph.out_neighbors(u).begin());
+        }
+    }
+    while (inserted.size() < batch_size) {
+        inserted.emplace_back(dist(rng), dist(rng));
+    }
+    Graph<Node> updated = apply_edge_updates(graph, inserted, deleted);
+
+    auto start = std::chrono::steady_clock::now();
+    long long touched = repair_bfs(updated, root, depth, inserted, deleted);
+    auto mid = std::chrono::steady_clock::now();
+    std::vector<Prop> expected = do_bfs(updated, root);
+    auto end = std::chrono::steady_clock::now();
+
+    std::cout << "Touched: " << touched << " / " << updated.get_vertex_number() << std::endl;
+    std::cout << "Repair: " << std::chrono::duration<double, std::milli>(mid - start).count() << " ms" << std::endl;
+    std::cout << "Recompute: " << std::chrono::duration<double, std::milli>(end - mid).count() << " ms" << std::endl;
+    std::cout << "Verification: " << ((depth == expected) ? "PASS" : "FAIL") << std::endl;
+    return 0;
+}
+
+int _6main(int argc, char *argv[]) {
+    fs::path graph_file_path(DATASET_PATH);
+    graph_file_path /= (argc < 2) ? "soc-LiveJournal1.txt" : argv[1];
+
+    Builder<Node> builder{graph_file_path.string(), true};
+    Graph<Node> graph;
+    {
+        Graph<Node> raw = builder.build_csr();
+        auto [g1, new_ids, new_ids_remap] = squeeze_graph(raw);
+        graph = simplify_graph(g1);
+    }
+    std::clog << "Graph: " << graph_file_path.string() << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    auto [ordered, new_ids, new_ids_remap] = reorder_by_degree(graph);
+    auto mid = std::chrono::steady_clock::now();
+    int64_t triangles = count_triangles_ordered(ordered);
+    auto end = std::chrono::steady_clock::now();
+    std::vector<double> coefficient = local_clustering(graph);
+    double avg_coefficient = std::reduce(coefficient.begin(), coefficient.end()) / graph.get_vertex_number();
+
+    std::cout << "Triangles: " << triangles << std::endl;
+    std::cout << "Average Clustering Coefficient: " << avg_coefficient << std::endl;
+    std::cout << "Reorder: " << std::chrono::duration<double, std::milli>(mid - start).count() << " ms" << std::endl;
+    std::cout << "Count: " << std::chrono::duration<double, std::milli>(end - mid).count() << " ms" << std::endl;
+    return 0;
+}
+
+int _7main(int argc, char *argv[]) {
+    fs::path graph_file_path(DATASET_PATH);
+    graph_file_path /= (argc < 2) ? "rmat_20.txt" : argv[1];
+    int iters = (argc < 3) ? 20 : std::stoi(argv[2]);
+
+    Builder<Node> builder{graph_file_path.string()};
+    Graph<Node> graph = builder.build_csr();
+    std::clog << "Graph: " << graph_file_path.string() << std::endl;
+
+    PageRank<Node> pr{graph};
+    std::cout << "Converged After: " << pr.run() << " iterations" << std::endl;
+
+    auto [ms, gbps] = benchmark_pagerank(graph, iters);
+    std::cout << "Iteration: " << ms << " ms" << std::endl;
+    std::cout << "Edge Bandwidth: " << gbps << " GB/s" << std::endl;
+    return 0;
+}
+
+template<bool UseBitmap>
+void sweep_prefetch_distance(Graph<Node> const &graph, std::vector<Node> const &sources) {
+    for (int distance : {0, 1, 2, 4, 8, 16, 32, 64}) {
+        long long edges_scanned{};
+        auto count_edges = [&](IterStats const &stats) { edges_scanned += stats.edges_scanned; };
+        auto start = std::chrono::steady_clock::now();
+        for (Node root : sources) {
+            do_pull_bfs<UseBitmap>(graph, root, distance, count_edges);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::format("{:<6} distance {:<3d} {:.2f} MTEPS (graph edges) {:.2f} M scanned edges/s",
+                                 UseBitmap ? "bitmap" : "depth", distance,
+                                 graph.get_edge_number() * sources.size() / seconds / 1e6,
+                                 edges_scanned / seconds / 1e6) << std::endl;
+    }
+}
+
+int _8main(int argc, char *argv[]) {
+    fs::path graph_file_path(DATASET_PATH);
+    graph_file_path /= (argc < 2) ? "rmat_20.txt" : argv[1];
+
+    Builder<Node> builder{graph_file_path.string()};
+    Graph<Node> graph = builder.build_csr();
+    std::clog << "Graph: " << graph_file_path.string() << std::endl;
+
+    std::vector<Node> sources = pick_sources(graph, 8);
+    do_pull_bfs(graph, sources[0]); // warm up
+    sweep_prefetch_distance<true>(graph, sources);
+    sweep_prefetch_distance<false>(graph, sources);
+    return 0;
+}
+
+int _9main(int argc, char *argv[]) {
+    fs::path graph_file_path(DATASET_PATH);
+    graph_file_path /= (argc < 2) ? "rmat_20.txt" : argv[1];
+
+    Builder<Node> builder{graph_file_path.string()};
+    Graph<Node> graph = builder.build_csr();
+    std::clog << "Graph: " << graph_file_path.string() << std::endl;
+    std::vector<Node> sources = pick_sources(graph, 16);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::vector<Prop>> wide;
+    for (Node root : sources) {
+        wide.emplace_back(do_bfs(graph, root));
+    }
+    auto mid = std::chrono::steady_clock::now();
+    // nullopt for sources whose depths do not fit the 8-bit range, those are only counted
+    std::vector<std::optional<std::vector<uint8_t>>> compact;
+    for (Node root : sources) {
+        compact.emplace_back(do_bitmap_bfs<uint8_t>(graph, root));
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    bool pass = true;
+    int overflowed{};
+    for (size_t i = 0; i < sources.size(); ++i) {
+        if (!compact[i]) {
+            overflowed++;
+            continue;
+        }
+        for (Node v = 0; v < graph.get_vertex_number(); ++v) {
+            pass = pass && (is_max_prop(wide[i][v]) ? is_max_prop((*compact[i])[v]) : wide[i][v] == (*compact[i])[v]);
+        }
+    }
+    std::cout << std::format("int depth: {:.2f} ms, {} bytes of depth state",
+                             std::chrono::duration<double, std::milli>(mid - start).count(),
+                             graph.get_vertex_number() * sizeof(Prop)) << std::endl;
+    std::cout << std::format("uint8_t depth + visited bitmap: {:.2f} ms, {} bytes of depth state",
+                             std::chrono::duration<double, std::milli>(end - mid).count(),
+                             graph.get_vertex_number() * sizeof(uint8_t) + (graph.get_vertex_number() + 7) / 8) << std::endl;
+    if (overflowed > 0) {
+        std::cout << std::format("{} of {} sources too deep for uint8_t depths, not compared", overflowed,
+                                 sources.size()) << std::endl;
+    }
+    std::cout << "Verification: " << (pass ? "PASS" : "FAIL") << std::endl;
+    return 0;
+}
+
+int _10main(int argc, char *argv[]) {
+    fs::path graph_file_path(DATASET_PATH);
+    graph_file_path /= (argc < 2) ? "rmat_20.txt" : argv[1];
+    // per source vertex: one frontier bit for BFS, one contribution for PageRank
+    int64_t segment_size = (argc < 3) ? llc_segment_size(sizeof(float)) : std::stoll(argv[2]);
+
+    Builder<Node> builder{graph_file_path.string()};
+    Graph<Node> graph = builder.build_csr();
+    std::clog << "Graph: " << graph_file_path.string() << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    SegmentedGraph<Node> sg{graph, segment_size};
+    std::cout << std::format("Segments: {} of {} vertices, built in {:.2f} ms", sg.get_segments().size(), segment_size,
+                             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count())
+              << std::endl;
+
+    std::vector<Node> sources = pick_sources(graph, 8);
+    bool pass = true;
+    double plain_ms{}, segmented_ms{};
+    for (Node root : sources) {
+        auto t0 = std::chrono::steady_clock::now();
+        auto expected = do_pull_bfs(graph, root);
+        auto t1 = std::chrono::steady_clock::now();
+        auto depth = do_segmented_pull_bfs(sg, root);
+        auto t2 = std::chrono::steady_clock::now();
+        plain_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        segmented_ms += std::chrono::duration<double, std::milli>(t2 - t1).count();
+        pass = pass && (depth == expected);
+    }
+    std::cout << std::format("Pull BFS: {:.2f} ms plain, {:.2f} ms segmented", plain_ms, segmented_ms) << std::endl;
+
+    int iters = 20;
+    auto t0 = std::chrono::steady_clock::now();
+    PageRank<Node> pr{graph};
+    pr.run(0, iters);
+    auto t1 = std::chrono::steady_clock::now();
+    auto scores = segmented_pagerank(graph, sg, 0, iters);
+    auto t2 = std::chrono::steady_clock::now();
+    double max_error{};
+    for (Node v = 0; v < graph.get_vertex_number(); ++v) {
+        max_error = std::max<double>(max_error, std::fabs(scores[v] - pr.get_scores()[v]));
+    }
+    std::cout << std::format("PageRank: {:.2f} ms plain, {:.2f} ms segmented per iteration, max difference {:.3g}",
+                             std::chrono::duration<double, std::milli>(t1 - t0).count() / iters,
+                             std::chrono::duration<double, std::milli>(t2 - t1).count() / iters, max_error) << std::endl;
+    std::cout << "Verification: " << (pass ? "PASS" : "FAIL") << std::endl;
+    return 0;
+}
+
+int _11main(int argc, char *argv[]) {
+    int min_scale = (argc < 2) ? 16 : std::stoi(argv[1]);
+    int max_scale = (argc < 3) ? 22 : std::stoi(argv[2]);
+
+    for (int scale = min_scale; scale <= max_scale; ++scale) {
+        RmatParams params;
+        params.scale = scale;
+        auto start = std::chrono::steady_clock::now();
+        Graph<Node> graph = Builder<Node>{}.build_csr(generate_rmat<Node>(params), int64_t{1} << scale);
+        auto built = std::chrono::steady_clock::now();
+
+        std::vector<Node> sources = pick_sources(graph, 8);
+        for (Node root : sources) {
+            do_pull_bfs(graph, root);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - built).count();
+        std::cout << std::format("rmat_{}: {} vertices {} edges, generated and built in {:.2f} ms, pull BFS {:.2f} MTEPS",
+                                 scale, graph.get_vertex_number(), graph.get_edge_number(),
+                                 std::chrono::duration<double, std::milli>(built - start).count(),
+                                 graph.get_edge_number() * sources.size() / seconds / 1e6) << std::endl;
+    }
+    return 0;
+}
+
+int _12main(int argc, char *argv[]) {
+    int scale = (argc < 2) ? 16 : std::stoi(argv[1]);
+    int tail_length = (argc < 3) ? 2000 : std::stoi(argv[2]);
+
+    // R-MAT core with a chain hanging off it, so that the traversal runs for tail_length more levels
+    RmatParams params;
+    params.scale = scale;
+    auto el = generate_rmat<Node>(params);
+    Node anchor = el[0].first;
+    Node tail = 1 << scale;
+    el.emplace_back(anchor, tail);
+    for (Node i = 0; i + 1 < tail_length; ++i) {
+        el.emplace_back(tail + i, tail + i + 1);
+    }
+    Graph<Node> graph = Builder<Node>{}.build_csr(std::move(el));
+    MemoryLayout<unsigned> layout{graph};
+    std::vector<Node> sources{anchor};
+    for (Node root : pick_sources(graph, 3)) {
+        sources.emplace_back(root);
+    }
+
+    std::tuple<long long, long long> results[2];
+    for (ResetMode mode : {ResetMode::full, ResetMode::touched}) {
+        Memory<unsigned> memory{layout, mode};
+        int levels{};
+        auto count_levels = [&levels](IterStats const &) { levels++; };
+        auto start = std::chrono::steady_clock::now();
+        long long edge_visit{}, edge_visit_cacheline{};
+        for (Node root : sources) {
+            auto [visit, visit_cacheline] = do_cacheline_bfs(graph, root, memory, count_levels);
+            edge_visit += visit;
+            edge_visit_cacheline += visit_cacheline;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        results[mode == ResetMode::touched] = {edge_visit, edge_visit_cacheline};
+        std::cout << std::format("{} reset: {:.2f} ms, {} levels, {} edges, {} cacheline edges",
+                                 mode == ResetMode::full ? "full" : "touched", ms, levels,
+                                 edge_visit, edge_visit_cacheline) << std::endl;
+    }
+    std::cout << "Verification: " << (results[0] == results[1] ? "PASS" : "FAIL") << std::endl;
+    return 0;
+}
+
+int _13main(int argc, char *argv[]) {
+    fs::path graph_file_path(DATASET_PATH);
+    graph_file_path /= (argc < 2) ? "rmat_20.txt" : argv[1];
+
+    // triangles (also after squeeze_graph and reorder_by_degree) and sorted component sizes,
+    // which both storages must agree on
+    std::tuple<int64_t, int64_t, int64_t, std::vector<int64_t>> results[2];
+    Graph<Node> graphs[2];
+    for (SymmetricStorage storage : {SymmetricStorage::full, SymmetricStorage::upper}) {
+        bool upper = storage == SymmetricStorage::upper;
+        auto start = std::chrono::steady_clock::now();
+        Graph<Node> raw = Builder<Node>{graph_file_path.string(), true, storage}.build_csr();
+        Graph<Node> &graph = graphs[upper] = simplify_graph(raw);
+        auto mid = std::chrono::steady_clock::now();
+        int64_t triangles = count_triangles(graph);
+        auto end = std::chrono::steady_clock::now();
+        std::vector<int64_t> sizes = component_sizes(afforest(graph));
+        std::erase(sizes, 0);
+        std::ranges::sort(sizes);
+        int64_t squeezed_triangles = count_triangles(std::get<0>(squeeze_graph(graph)));
+        int64_t reordered_triangles = count_triangles(std::get<0>(reorder_by_degree(graph)));
+        results[upper] = {triangles, squeezed_triangles, reordered_triangles, sizes};
+
+        auto stored = graph.get_offset()[graph.get_vertex_number()];
+        std::cout << std::format("{:<5} storage: build {:.2f} ms, {} stored edges ({:.2f} MB), "
+                                 "{} triangles in {:.2f} ms, {} components",
+                                 upper ? "upper" : "full", std::chrono::duration<double, std::milli>(mid - start).count(),
+                                 stored, stored * sizeof(Node) / 1e6, triangles,
+                                 std::chrono::duration<double, std::milli>(end - mid).count(), sizes.size()) << std::endl;
+        if (upper) {
+            std::cout << "Transpose Built: " << (graph.has_transpose() ? "yes" : "no") << std::endl;
+        }
+    }
+
+    // the upper graph's lower and upper halves together are the full neighborhood, but for the
+    // self loops upper storage drops
+    bool same_neighbors = graphs[0].get_vertex_number() == graphs[1].get_vertex_number();
+    std::vector<Node> full;
+    for (Node v = 0; same_neighbors && v < graphs[0].get_vertex_number(); ++v) {
+        full.clear();
+        std::ranges::remove_copy(graphs[0].out_neighbors(v), std::back_inserter(full), v);
+        auto halves = graphs[1].full_neighbors(v);
+        same_neighbors = graphs[1].full_degree(v) == full.size()
+                         && std::equal(full.begin(), full.end(), halves.begin(), halves.end());
+    }
+    bool same_clustering = local_clustering(graphs[0]) == local_clustering(graphs[1]);
+    std::cout << "Full Neighbors: " << (same_neighbors ? "PASS" : "FAIL") << std::endl;
+    std::cout << "Local Clustering: " << (same_clustering ? "PASS" : "FAIL") << std::endl;
+    std::cout << "Verification: " << (results[0] == results[1] && same_neighbors && same_clustering ? "PASS" : "FAIL")
+              << std::endl;
+    return 0;
+}
+
+int _14main(int argc, char *argv[]) {
+    fs::path graph_file_path(DATASET_PATH);
+    graph_file_path /= (argc < 2) ? "rmat_20.txt" : argv[1];
+    int query_num = (argc < 3) ? 64 : std::stoi(argv[2]);
+
+    Graph<Node> graph = Builder<Node>{graph_file_path.string()}.build_csr();
+    std::clog << "Graph: " << graph_file_path.string() << std::endl;
+    std::vector<Node> sources = pick_sources(graph, query_num);
+    std::vector<Node> targets = pick_sources(graph, query_num);
+    std::vector<std::pair<Node, Node>> queries;
+    for (int i = 0; i < query_num; ++i) {
+        queries.emplace_back(sources[i], targets[i]);
+    }
+
+    std::vector<Prop> expected;
+    auto start = std::chrono::steady_clock::now();
+    for (auto [s, t] : queries) {
+        expected.emplace_back(do_bfs(graph, s)[t]);
+    }
+    auto mid = std::chrono::steady_clock::now();
+    BidirectionalBFS<Node> search{graph};
+    std::vector<Prop> distances;
+    long long edges_scanned{};
+    auto count_edges = [&edges_scanned](IterStats const &stats) { edges_scanned += stats.edges_scanned; };
+    for (auto [s, t] : queries) {
+        distances.emplace_back(search.distance(s, t, count_edges));
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::vector<Prop> batched = bidirectional_distances(graph, queries);
+    auto batch_end = std::chrono::steady_clock::now();
+
+    std::cout << std::format("Full BFS: {:.3f} ms per query",
+                             std::chrono::duration<double, std::milli>(mid - start).count() / query_num) << std::endl;
+    std::cout << std::format("Bidirectional: {:.3f} ms per query, {:.0f} edges scanned per query",
+                             std::chrono::duration<double, std::milli>(end - mid).count() / query_num,
+                             static_cast<double>(edges_scanned) / query_num) << std::endl;
+    std::cout << std::format("Batched: {:.0f} queries/s",
+                             query_num / std::chrono::duration<double>(batch_end - end).count()) << std::endl;
+    std::cout << "Verification: " << (distances == expected && batched == expected ? "PASS" : "FAIL") << std::endl;
+    return 0;
+}
+
+int _15main(int argc, char *argv[]) {
+    fs::path graph_file_path(DATASET_PATH);
+    graph_file_path /= (argc < 2) ? "rmat_20.txt" : argv[1];
+    int parts = (argc < 3) ? omp_get_max_threads() : std::stoi(argv[2]);
+
+    Graph<Node> graph = Builder<Node>{graph_file_path.string()}.build_csr();
+    std::clog << "Graph: " << graph_file_path.string() << std::endl;
+    typedef Graph<Node>::offset_t offset_t;
+    offset_t const *offset = graph.get_in_offset();
+    int64_t vertex_number = graph.get_vertex_number();
+    Node const *in_neigh = graph.in_neighbors(0).begin() - offset[0];
+    std::vector<float> contrib(vertex_number, 1.0f);
+
+    // one pull pass (the PageRank gather) per partition, timing every chunk on its own
+    std::pair<std::string, EdgePartition<Node, offset_t>> partitions[] = {
+        {"vertex", vertex_balanced_partition<Node>(offset, vertex_number, parts)},
+        {"edge", edge_balanced_partition<Node>(offset, vertex_number, parts, std::numeric_limits<offset_t>::max())},
+        {"edge+hub", edge_balanced_partition<Node>(offset, vertex_number, parts)}};
+    for (auto const &[name, partition] : partitions) {
+        std::vector<double> seconds(partition.size());
+        double checksum{};
+        auto start = std::chrono::steady_clock::now();
+#pragma omp parallel for default(shared) schedule(static, 1) reduction(+ : checksum)
+        for (size_t p = 0; p < partition.size(); ++p) {
+            auto chunk_start = std::chrono::steady_clock::now();
+            partition.for_each_vertex(p, offset, [&](Node, offset_t begin, offset_t end, bool) {
+                checksum += gather_sum(contrib.data(), in_neigh + begin, end - begin);
+            });
+            seconds[p] = std::chrono::duration<double>(std::chrono::steady_clock::now() - chunk_start).count();
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        double slowest = *std::max_element(seconds.begin(), seconds.end());
+        double mean = std::reduce(seconds.begin(), seconds.end()) / seconds.size();
+        std::cout << std::format("{:<8} work imbalance {:.3f}, time imbalance {:.3f}, pass {:.2f} ms, {} edges",
+                                 name, partition_imbalance(partition), slowest / mean, ms,
+                                 static_cast<long long>(checksum)) << std::endl;
+    }
+    return 0;
+}